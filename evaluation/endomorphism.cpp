@@ -9,7 +9,7 @@ int main()
 
     Theory theory;
 
-    auto m = theory.add_operator("*", AC);
+    auto m = theory.add_operator("*", A); // composition does not commute
     auto h = theory.add_operator("h", 1);
 
     // h(x * y) = h(x) * h(y)
@@ -11,9 +11,8 @@ EGraph create_egraph()
 
     theory.add_operator("one", 0);
     theory.add_operator("inv", 1);
-    theory.add_operator("mul", AC);
+    theory.add_operator("mul", AC, "one");
 
-    theory.add_rewrite_rule("identity", "(mul ?x (one))", "?x");
     theory.add_rewrite_rule("inverse", "(mul ?x (inv ?x))", "(one)");
 
     theory.add_operator("v0", 0);
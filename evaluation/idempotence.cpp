@@ -8,16 +8,14 @@ int main()
     Theory theory;
 
     auto a = theory.add_operator("a", 0);
-    auto andd = theory.add_operator("and", AC);
-
-    theory.add_rewrite_rule("and_idem", "(and ?x ?x)", "?x");
+    auto andd = theory.add_operator("and", ACI);
 
     EGraph egraph(theory);
 
     auto a_expr = Expr::make_operator(a);
 
-    // and(a, a, a, a, a) with idempotent rule
-    // Expected: rule should fire multiple times to reduce and(a*5) -> a
+    // and(a, a, a, a) with an ACI operator
+    // Expected: the repeated children collapse on insertion, and(a*4) -> a
     auto and_expr = Expr::make_operator(andd, {
                                                   a_expr,
                                                   a_expr,
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "concurrent_union_find.h"
+#include "union_find.h"
+
+using namespace eqsat;
+
+// Unifies random pairs and canonicalizes random ids, like rebuilding does,
+// with UnionFind on one thread and with ConcurrentUnionFind on 1..N threads.
+//
+// usage: union_find_bench [ids] [unifications] [max threads]
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Workload
+{
+    size_t nids;
+    Vec<std::pair<id_t, id_t>> pairs;
+    Vec<id_t> finds;
+};
+
+Workload make_workload(size_t nids, size_t nunions)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<id_t> dist(0, static_cast<id_t>(nids - 1));
+
+    Workload work{nids, {}, {}};
+    for (size_t i = 0; i < nunions; ++i)
+    {
+        work.pairs.push_back({dist(rng), dist(rng)});
+
+        // canonicalizations outnumber unifications by far
+        for (int j = 0; j < 8; ++j)
+            work.finds.push_back(dist(rng));
+    }
+
+    return work;
+}
+
+void report(const std::string& name, size_t nops, Clock::duration elapsed)
+{
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::cout << name << ": " << seconds * 1000 << " ms, " << nops / seconds / 1e6 << " Mops/s" << std::endl;
+}
+
+size_t sequential(const Workload& work)
+{
+    UnionFind uf;
+    for (size_t i = 0; i < work.nids; ++i)
+        uf.make_set();
+
+    auto start = Clock::now();
+
+    size_t checksum = 0;
+    for (size_t i = 0; i < work.pairs.size(); ++i)
+    {
+        uf.unify(work.pairs[i].first, work.pairs[i].second);
+        for (size_t j = 8 * i; j < 8 * i + 8; ++j)
+            checksum += uf.find_root(work.finds[j]);
+    }
+
+    (void)checksum;
+    report("sequential", work.pairs.size() + work.finds.size(), Clock::now() - start);
+    return uf.eclasses();
+}
+
+size_t concurrent(const Workload& work, size_t nthreads)
+{
+    ConcurrentUnionFind uf;
+    for (size_t i = 0; i < work.nids; ++i)
+        uf.make_set();
+
+    auto start = Clock::now();
+
+    Vec<std::thread> threads;
+    for (size_t t = 0; t < nthreads; ++t)
+    {
+        threads.emplace_back([&work, &uf, t, nthreads]() {
+            size_t checksum = 0;
+            for (size_t i = t; i < work.pairs.size(); i += nthreads)
+            {
+                uf.unify(work.pairs[i].first, work.pairs[i].second);
+                for (size_t j = 8 * i; j < 8 * i + 8; ++j)
+                    checksum += uf.find_root(work.finds[j]);
+            }
+
+            (void)checksum;
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    report("concurrent x" + std::to_string(nthreads), work.pairs.size() + work.finds.size(), Clock::now() - start);
+    return uf.eclasses();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t nids = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    size_t nunions = argc > 2 ? std::stoul(argv[2]) : 1000000;
+    size_t max_threads = argc > 3 ? std::stoul(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+
+    auto work = make_workload(nids, nunions);
+
+    size_t expected = sequential(work);
+    for (size_t nthreads = 1; nthreads <= max_threads; nthreads *= 2)
+    {
+        if (concurrent(work, nthreads) != expected)
+        {
+            std::cerr << "concurrent union-find disagrees on the number of e-classes" << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
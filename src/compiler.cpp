@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <string>
 #include <utility>
 
 #include "compiler.h"
@@ -6,6 +8,20 @@
 namespace eqsat
 {
 
+namespace
+{
+
+void collect_rests(const std::shared_ptr<Expr>& expr, HashSet<Symbol>& rests)
+{
+    if (expr->is_rest())
+        rests.insert(expr->symbol);
+
+    for (const auto& child : expr->children)
+        collect_rests(child, rests);
+}
+
+} // namespace
+
 HashMap<var_t, int> create_consecutive_index_map(const Vec<var_t>& unique_indices)
 {
     HashMap<var_t, int> index_map;
@@ -31,7 +47,7 @@ int Compiler::count_ac_operators(const std::shared_ptr<Expr>& expr) const
     if (expr->is_variable())
         return 0;
 
-    int count = theory.get_arity(expr->symbol) == AC ? 1 : 0;
+    int count = theory.is_associative(expr->symbol) ? 1 : 0;
 
     for (const auto& child : expr->children)
         count += count_ac_operators(child);
@@ -57,29 +73,49 @@ var_t Compiler::compile_rec(const std::shared_ptr<Expr>& expr, HashMap<Symbol, v
     {
         Vec<var_t> constraint_vars;
 
-        // AC term-ids get IDs from a separate counter (0, 1, 2, ...)
+        // AC and A term-ids get IDs from a separate counter (0, 1, 2, ...)
         // This ensures ALL term-ids < ALL pattern variables and eclass-ids
-        if (theory.get_arity(expr->symbol) == AC)
+        if (theory.is_associative(expr->symbol))
         {
             var_t term_id = next_term_id++;
             constraint_vars.push_back(term_id);
         }
 
+        // The rest variable is compiled last, so it is bound only
+        // after all other children of the AC operator are selected.
+        std::shared_ptr<Expr> rest = nullptr;
         for (const auto& child : expr->children)
         {
+            if (child->is_rest())
+            {
+                rest = child;
+                continue;
+            }
+
             var_t child_var = compile_rec(child, symbol_to_var, query);
             constraint_vars.push_back(child_var);
         }
 
+        if (rest != nullptr)
+            constraint_vars.push_back(compile_rec(rest, symbol_to_var, query));
+
         // E-class IDs also use next_id (come after AC term-ids)
         var_t eclass_id = next_id++;
         constraint_vars.push_back(eclass_id);
 
         // For AC constraints, use explicit permutation value to mark them
         // This prevents FD optimization with TrieIndex for AC operators
-        if (theory.get_arity(expr->symbol) == AC)
+        if (theory.is_ac(expr->symbol))
         {
-            query.add_constraint(Constraint(expr->symbol, constraint_vars, static_cast<uint32_t>(AC)));
+            Constraint constraint(expr->symbol, constraint_vars, static_cast<uint32_t>(AC));
+            constraint.rest = rest != nullptr;
+            query.add_constraint(constraint);
+        }
+        else if (theory.get_arity(expr->symbol) == A)
+        {
+            // the children are numbered left to right, which is
+            // the order in which the sequence index selects them
+            query.add_constraint(Constraint(expr->symbol, constraint_vars, static_cast<uint32_t>(A)));
         }
         else
         {
@@ -90,6 +126,79 @@ var_t Compiler::compile_rec(const std::shared_ptr<Expr>& expr, HashMap<Symbol, v
     }
 }
 
+std::string Compiler::canonical_form(const std::shared_ptr<Expr>& expr, Symbol a, Symbol b) const
+{
+    if (expr->is_variable())
+    {
+        Symbol var = expr->symbol == a ? b : (expr->symbol == b ? a : expr->symbol);
+        return "?" + std::to_string(var);
+    }
+
+    Vec<std::string> children;
+    for (const auto& child : expr->children)
+        children.push_back(canonical_form(child, a, b));
+
+    if (theory.is_commutative(expr->symbol))
+        std::sort(children.begin(), children.end());
+
+    std::string out = "(" + std::to_string(expr->symbol);
+    for (const auto& child : children)
+        out += " " + child;
+
+    return out + ")";
+}
+
+void Compiler::add_symmetries(const RewriteRule& rule, const HashMap<Symbol, var_t>& env, Query& query) const
+{
+    // Rest variables are bound to fresh ephemeral ids, which
+    // are not comparable between mirrored matches. Skip them.
+    HashSet<Symbol> rests;
+    collect_rests(rule.lhs, rests);
+
+    Vec<std::pair<var_t, Symbol>> vars;
+    for (const auto& [sym, var] : env)
+        if (!rests.contains(sym))
+            vars.push_back({var, sym});
+
+    std::sort(vars.begin(), vars.end());
+
+    std::string lhs = canonical_form(rule.lhs, 0, 0);
+    std::string rhs = canonical_form(rule.rhs, 0, 0);
+
+    // Transpositions of interchangeable variables generate the full symmetric
+    // group on each connected group, so sorting every group is always sound.
+    Vec<size_t> group(vars.size());
+    for (size_t i = 0; i < vars.size(); ++i)
+    {
+        group[i] = i;
+
+        for (size_t j = 0; j < i; ++j)
+        {
+            if (group[j] != j)
+                continue;
+
+            Symbol a = vars[j].second, b = vars[i].second;
+            if (canonical_form(rule.lhs, a, b) == lhs && canonical_form(rule.rhs, a, b) == rhs)
+            {
+                group[i] = j;
+                break;
+            }
+        }
+    }
+
+    // chain the members of each group in ascending variable order
+    HashMap<size_t, var_t> last;
+    for (size_t i = 0; i < vars.size(); ++i)
+    {
+        auto [it, inserted] = last.try_emplace(group[i], vars[i].first);
+        if (inserted)
+            continue;
+
+        query.symmetries.push_back({it->second, vars[i].first});
+        it->second = vars[i].first;
+    }
+}
+
 std::pair<Query, Subst> Compiler::compile(RewriteRule rule)
 {
     // Pass 1: Count AC operators to reserve term-id slots
@@ -111,13 +220,18 @@ std::pair<Query, Subst> Compiler::compile(RewriteRule rule)
     var_t root = compile_rec(rule.lhs, env, query);
     query.add_head_var(root);
 
+    add_symmetries(rule, env, query);
+
     HashMap<Symbol, int> env2;
     auto transl = create_consecutive_index_map(query.head);
 
     for (const auto [sym, var] : env)
         env2[sym] = transl[var];
 
-    Subst subst(rule.name, rule.rhs, env2, query.head.size());
+    HashSet<Symbol> rests;
+    collect_rests(rule.lhs, rests);
+
+    Subst subst(rule.name, rule.rhs, env2, query.head.size(), std::move(rests), theory.units);
 
     return std::pair(query, subst);
 }
@@ -20,8 +20,10 @@
  *
  * **Standard operators**: `mul(x, y; result_id)` - children first, then result
  * **AC operators**: `mul_ac(result_id, term_id, x, y, ...)` - result and term-id first, then children
+ * **A operators**: same layout as AC operators, but the children are matched in order
+ * against a contiguous window of the flattened sequence (see SequenceIndex)
  *
- * The term-id for AC operators disambiguates different terms in the same e-class.
+ * The term-id for AC and A operators disambiguates different terms in the same e-class.
  *
  * # Query Head Construction
  *
@@ -58,6 +60,23 @@
  * - Each rule gets independent variable ID space
  * - Returns vector of (Query, Subst) pairs
  *
+ * # Rest Variables
+ *
+ * A rest variable `?rest...` must be a direct child of an AC operator. It is
+ * compiled after all other children of that operator and marks the constraint
+ * (see Constraint::rest), so the engine binds it to the remaining children
+ * once everything else is selected.
+ *
+ * # Symmetry Breaking
+ *
+ * Two pattern variables are interchangeable if swapping them leaves both the
+ * LHS and the RHS unchanged up to the order of AC and C children, as for `?x` and
+ * `?y` in `(mul ?x ?y)` or `?y` and `?z` in `(+ (* ?x ?y) (* ?x ?z))`. Every
+ * match then has a mirror image with the two values swapped which yields the
+ * same instantiated RHS. Interchangeable variables are grouped and the query
+ * gets a chain of ordering constraints per group (see Query::symmetries), so
+ * the engine only enumerates non-decreasing assignments of them.
+ *
  * # Invariants
  *
  * 1. **Variable Ordering**: Parent IDs > children IDs (post-order)
@@ -77,6 +96,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "query.h"
 #include "theory.h"
@@ -89,14 +109,20 @@ class Compiler
   private:
     const Theory& theory;
     var_t next_id;
-    var_t next_term_id; // Separate counter for AC term-ids
+    var_t next_term_id; // Separate counter for AC and A term-ids
 
-    // Pass 1: Count AC operators in the expression tree
+    // Pass 1: Count AC and A operators in the expression tree
     int count_ac_operators(const std::shared_ptr<Expr>& expr) const;
 
     // Pass 2: Compile with proper ID assignment
     var_t compile_rec(const std::shared_ptr<Expr>& expr, HashMap<Symbol, var_t>& env, Query& query);
 
+    // Serialize expr with the pattern variables a and b swapped and AC children sorted
+    std::string canonical_form(const std::shared_ptr<Expr>& expr, Symbol a, Symbol b) const;
+
+    // Pass 3: Detect interchangeable pattern variables
+    void add_symmetries(const RewriteRule& rule, const HashMap<Symbol, var_t>& env, Query& query) const;
+
   public:
     Compiler(const Theory& theory);
 
@@ -0,0 +1,83 @@
+#include <utility>
+
+#include "concurrent_union_find.h"
+
+namespace eqsat
+{
+
+ConcurrentUnionFind::ConcurrentUnionFind(ConcurrentUnionFind&& other) noexcept
+    : vec(std::move(other.vec))
+    , nclasses(other.nclasses.load())
+    , slots(std::move(other.slots))
+    , nlogged(other.nlogged.load())
+    , log(std::move(other.log))
+{
+}
+
+ConcurrentUnionFind& ConcurrentUnionFind::operator=(ConcurrentUnionFind&& other) noexcept
+{
+    vec = std::move(other.vec);
+    nclasses = other.nclasses.load();
+    slots = std::move(other.slots);
+    nlogged = other.nlogged.load();
+    log = std::move(other.log);
+    return *this;
+}
+
+id_t ConcurrentUnionFind::make_set()
+{
+    nclasses.fetch_add(1, std::memory_order_relaxed);
+    id_t x = static_cast<id_t>(vec.size());
+    vec.push_back(x);
+    slots.push_back(x);
+    return x;
+}
+
+id_t ConcurrentUnionFind::unify(id_t a, id_t b)
+{
+    while (true)
+    {
+        a = find_root(a);
+        b = find_root(b);
+
+        if (a == b)
+            return a;
+
+        if (a > b)
+            std::swap(a, b);
+
+        // only succeeds while b is still a root
+        if (vec[b].compare_exchange(b, a))
+            break;
+    }
+
+    slots[nlogged.fetch_add(1, std::memory_order_relaxed)].store(b);
+    nclasses.fetch_sub(1, std::memory_order_relaxed);
+
+    return a;
+}
+
+void ConcurrentUnionFind::sync_log()
+{
+    size_t n = nlogged.load(std::memory_order_relaxed);
+    for (size_t i = log.size(); i < n; ++i)
+        log.push_back(slots[i].load());
+}
+
+void ConcurrentUnionFind::normalize()
+{
+    // parents are smaller than their children and visited first
+    for (size_t i = 0; i < vec.size(); ++i)
+        vec[i].store(vec[vec[i].load()].load());
+}
+
+void ConcurrentUnionFind::dump_to_file(std::ofstream& out) const
+{
+    Vec<id_t> roots(vec.size());
+    for (size_t i = 0; i < vec.size(); ++i)
+        roots[i] = find_root(static_cast<id_t>(i));
+
+    dump_classes(out, roots);
+}
+
+} // namespace eqsat
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <fstream>
+
+#include "types.h"
+#include "union_find.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Union-find whose unify and find may be called from many threads at once
+ *
+ * A drop-in replacement for UnionFind, selected for the e-graph with the CMake
+ * option EQSAT_CONCURRENT_UNION_FIND. Roots are linked with a single CAS on
+ * the parent pointer of the root which loses. The priority is index-based,
+ * the larger root is always linked below the smaller one, so every parent
+ * pointer points to a smaller id and no interleaving can create a cycle.
+ * A failed CAS means the loser stopped being a root in the meantime, and
+ * unify retries from the new roots.
+ *
+ * Since the smallest id of a class always ends up as its root, the canonical
+ * ids are the same as with UnionPolicy::LowestId, whatever order concurrent
+ * unifications happen to take effect in. Only the order of the union log
+ * depends on the schedule.
+ *
+ * Finds are wait-free and use path splitting: every visited id is pointed
+ * at its grandparent with a CAS that is allowed to fail, because another
+ * thread has then moved the pointer closer to the root already.
+ *
+ * unify only claims a slot for the re-rooted id. sync_log copies the claimed
+ * slots into the union log, serially, before the log is read again, so that
+ * union_log itself only reads and relations can scan it from many threads.
+ *
+ * make_set and sync_log must not run concurrently with any other method.
+ */
+class ConcurrentUnionFind
+{
+  private:
+    Vec<AtomicId> vec;
+    std::atomic<size_t> nclasses{0};
+
+    // Every id enters the log at most once, so the slots are allocated
+    // along with the ids and unify claims the next one with a counter.
+    Vec<AtomicId> slots;
+    std::atomic<size_t> nlogged{0};
+    // the claimed slots copied out by sync_log
+    Vec<id_t> log;
+
+  public:
+    ConcurrentUnionFind() = default;
+    ~ConcurrentUnionFind() = default;
+
+    ConcurrentUnionFind(const ConcurrentUnionFind&) = delete;
+    ConcurrentUnionFind& operator=(const ConcurrentUnionFind&) = delete;
+
+    ConcurrentUnionFind(ConcurrentUnionFind&& other) noexcept;
+    ConcurrentUnionFind& operator=(ConcurrentUnionFind&& other) noexcept;
+
+    size_t eclasses() const
+    {
+        return nclasses.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Only UnionPolicy::LowestId is supported, linking by size takes more than one CAS
+     */
+    void set_policy(UnionPolicy policy)
+    {
+        assert(policy == UnionPolicy::LowestId);
+        (void)policy;
+    }
+
+    id_t make_set();
+    id_t unify(id_t a, id_t b);
+
+    inline id_t find_root_mut(id_t x) noexcept
+    {
+        return find_root(x);
+    }
+
+    inline id_t find_root(id_t x) const noexcept
+    {
+        while (true)
+        {
+            id_t parent = vec[x].load();
+            if (parent == x)
+                return x;
+
+            // path splitting, a failed CAS only skips one shortcut
+            id_t grandparent = vec[parent].load();
+            if (parent != grandparent)
+                vec[x].compare_exchange(parent, grandparent);
+
+            x = parent;
+        }
+    }
+
+    /**
+     * @brief Check whether a and b are in the same class
+     *
+     * Unifications racing with this call may merge the classes
+     * right after it returned false, never the other way round.
+     */
+    inline bool same(id_t a, id_t b) const noexcept
+    {
+        while (true)
+        {
+            a = find_root(a);
+            b = find_root(b);
+
+            if (a == b)
+                return true;
+
+            // a root which is still a root has not been merged since
+            if (vec[a].load() == a)
+                return false;
+        }
+    }
+
+    std::size_t size() const noexcept
+    {
+        return vec.size();
+    }
+
+    /**
+     * @brief Copy the ids which unify logged since the last call into the union log
+     */
+    void sync_log();
+
+    /**
+     * @brief Get the log of ids which were re-rooted by unify, see UnionFind::union_log
+     *
+     * @pre sync_log ran after the last unify
+     */
+    const Vec<id_t>& union_log() const noexcept
+    {
+        assert(log.size() == nlogged.load(std::memory_order_relaxed));
+        return log;
+    }
+
+    void normalize();
+
+    void dump_to_file(std::ofstream& out) const;
+};
+
+} // namespace eqsat
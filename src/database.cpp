@@ -1,11 +1,31 @@
+#include <algorithm>
 #include <cassert>
 #include <fstream>
+#include <thread>
 
 #include "database.h"
+#include "utils/parallel.h"
 
 namespace eqsat
 {
 
+namespace
+{
+
+// Below this many pending tuples and log entries spawning threads costs more than it saves.
+constexpr size_t PARALLEL_REBUILD_THRESHOLD = 4096;
+
+// Smaller multiset stores are never swept.
+constexpr size_t MULTISET_SWEEP_THRESHOLD = 1024;
+
+} // namespace
+
+Database::Database()
+    : msets(std::make_shared<MultisetStore>())
+    , rebuild_threads(std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
 void Database::clear_indices()
 {
     indices.clear();
@@ -15,15 +35,106 @@ bool Database::rebuild(Handle handle)
 {
     bool did_something = false;
 
+    // Fix the order in which relations are visited,
+    // the unions of each round get applied in this order.
+    Vec<std::pair<Symbol, AbstractRelation *>> rows;
+    Vec<std::pair<Symbol, AbstractRelation *>> flattened;
     for (auto& [name, relation] : relations)
     {
-        bool result = relation.rebuild(handle);
-        did_something = did_something || result;
+        if (relation.is_flattened())
+            flattened.push_back({name, &relation});
+        else
+            rows.push_back({name, &relation});
     }
 
+    std::sort(rows.begin(), rows.end());
+    std::sort(flattened.begin(), flattened.end());
+
+    Vec<Vec<std::pair<id_t, id_t>>> unions(rows.size());
+
+    // Every relation only repairs the tuples of e-classes which were merged
+    // since it last looked at the union log. AC and A relations unify as well,
+    // so passes repeat until one of them leaves the union log untouched.
+    while (true)
+    {
+        handle.sync_union_log();
+        size_t nmerges = handle.union_log().size();
+
+        while (true)
+        {
+            size_t pending = 0;
+            for (const auto& [_, relation] : rows)
+                pending += relation->pending(handle);
+
+            if (pending == 0)
+                break;
+
+            size_t nthreads = pending < PARALLEL_REBUILD_THRESHOLD ? 1 : rebuild_threads;
+
+            // the union-find is only read during a round, the union log
+            // was synced after the unifications which preceded it
+            parallel_for(rows.size(), nthreads, [&](size_t i) {
+                unions[i].clear();
+                rows[i].second->collect_unions(handle, unions[i]);
+            });
+
+            bool merged = false;
+            for (const auto& buffer : unions)
+                merged = merged || !buffer.empty();
+
+#ifdef EQSAT_CONCURRENT_UNION_FIND
+            // lowest ids stay canonical in any order, see ConcurrentUnionFind
+            parallel_for(unions.size(), nthreads, [&](size_t i) {
+                for (const auto& [a, b] : unions[i])
+                    handle.unify(a, b);
+            });
+#else
+            for (const auto& buffer : unions)
+                for (const auto& [a, b] : buffer)
+                    handle.unify(a, b);
+#endif
+
+            handle.sync_union_log();
+
+            if (!merged)
+                break;
+
+            did_something = true;
+        }
+
+        for (auto& [_, relation] : flattened)
+        {
+            bool result = relation->rebuild(handle);
+            did_something = did_something || result;
+        }
+
+        handle.sync_union_log();
+        if (handle.union_log().size() == nmerges)
+            break;
+    }
+
+    // a sweep takes time linear in the store, doubling keeps it amortized constant per multiset
+    if (msets->size() >= std::max(MULTISET_SWEEP_THRESHOLD, 2 * nlive_msets))
+        sweep_multisets();
+
     return did_something;
 }
 
+void Database::sweep_multisets()
+{
+    Vec<bool> live(msets->capacity(), false);
+
+    for (auto& [_, relation] : relations)
+        if (relation.is_ac())
+            relation.mark_multisets(live);
+
+    for (const auto& [_, index] : indices)
+        index.mark_multisets(*msets, live);
+
+    msets->sweep(live);
+    nlive_msets = msets->size();
+}
+
 void Database::dump_to_file(std::ofstream& out, const SymbolTable& symbols) const
 {
 
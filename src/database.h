@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 
 #include "indices/abstract_index.h"
@@ -23,14 +25,19 @@ namespace eqsat
 using IndexKey = std::pair<Symbol, uint32_t>;
 
 /**
- * @brief Database for equality saturation with support for both standard and AC operators
+ * @brief Database for equality saturation with support for standard, C and AC operators
  *
  * # Overview
  *
  * The Database manages relations and indices for efficient conjunctive query execution
- * in an equality saturation framework. It supports two types of operators:
+ * in an equality saturation framework. It supports three types of operators:
  * - **Standard operators**: Use ordered tuple storage (RowStore) and trie indices
+ * - **C operators**: Binary commutative operators, stored once with sorted arguments
+ *   (RelationC) and indexed by one trie over the sorted tuples which matches both
+ *   argument orders (CommutativeIndex)
  * - **AC operators**: Use multiset-based storage (RelationAC) and multiset indices
+ * - **A operators**: Associative operators, stored as flattened argument sequences
+ *   (RelationA) and indexed by contiguous windows (SequenceIndex)
  *
  * # Architecture
  *
@@ -38,11 +45,13 @@ using IndexKey = std::pair<Symbol, uint32_t>;
  *
  * 1. **Relations**: Store tuples representing terms in the e-graph
  *    - Each relation is identified by an operator symbol
- *    - Relations can be standard (RowStore) or AC (RelationAC)
+ *    - Relations can be standard (RowStore), C (RelationC), AC (RelationAC) or A (RelationA)
  *    - Type-erased via AbstractRelation for uniform interface
  *
  * 2. **Indices**: Enable efficient query evaluation via select/project operations
  *    - Standard operators: TrieIndex with support for multiple permutations
+ *    - C operators: CommutativeIndex, shared by the permutations which only differ
+ *      in the order of the two argument columns
  *    - AC operators: MultisetIndex (permutation-invariant, always normalized to 0)
  *    - Type-erased via AbstractIndex for uniform traversal interface
  *
@@ -73,6 +82,10 @@ using IndexKey = std::pair<Symbol, uint32_t>;
  *
  * AC (Associative-Commutative) operators require special treatment:
  * - Arguments stored as **multisets** rather than ordered tuples
+ * - All AC relations intern their multisets in one shared MultisetStore,
+ *   tuples and indices only hold the compact multiset ids. Rebuild sweeps
+ *   the multisets left behind by canonicalization once the store has
+ *   doubled since the previous sweep
  * - Only one index per AC relation (permutation always normalized to 0)
  * - Pattern matching is order-independent: `mul(x, 2)` matches both `mul(2, x)` and `mul(x, 2)`
  * - `has_index()` and `get_index()` normalize any permutation to 0 for AC relations
@@ -81,8 +94,11 @@ using IndexKey = std::pair<Symbol, uint32_t>;
  *
  * ## Relation Management
  * - `create_relation(symbol, arity)`: Create standard relation
+ * - `create_relation_c(symbol)`: Create C relation
  * - `create_relation_ac(symbol)`: Create AC relation
+ * - `create_relation_a(symbol)`: Create A relation
  * - `add_tuple(symbol, tuple)`: Insert tuple into relation
+ * - `lookup(symbol, args)`: Find the e-class of a term, see "Hash-Cons" below
  * - `has_relation(symbol)`: Check relation existence
  *
  * ## Index Management
@@ -94,8 +110,12 @@ using IndexKey = std::pair<Symbol, uint32_t>;
  * ## Rebuild
  * - `rebuild(handle)`: Detect and unify equivalent terms across all relations
  *   - Scans for tuples with same arguments but different e-class IDs
+ *   - Standard relations are rebuilt in parallel rounds, see below
  *   - Calls handle's unify to merge e-classes
  *   - Returns true if any unifications occurred
+ * - `set_rebuild_threads(n)`: Number of threads used for rebuilding
+ * - `set_lazy_flattening(b)`: Derive flattened AC tuples on demand instead of storing them
+ * - `set_ac_limits(limits)`: Bound the tuples derived by AC and A flattening, see ACLimits
  *
  * # Usage Example
  *
@@ -135,6 +155,31 @@ using IndexKey = std::pair<Symbol, uint32_t>;
  *   - Only traversal state (history stack) is duplicated
  * - `populate_index()` is atomic: creates and populates in one call
  * - AC relations always normalize permutation to 0 in all operations
+ *
+ * # Hash-Cons
+ *
+ * Every relation hashes its tuples by their arguments, and these hash indices
+ * are the only hash-cons of the e-graph. A term is found by probing the
+ * relation of its operator with its normalized, canonical children, there is
+ * no second copy of the terms keyed by e-nodes. The hash indices are kept
+ * canonical by rebuild along with the tuples themselves.
+ *
+ * # Parallel Rebuild
+ *
+ * Standard and C relations are rebuilt in rounds. Within a round every relation
+ * only reads the union-find and appends the pairs of congruent e-class ids
+ * to a buffer of its own, so all relations of a round can run concurrently.
+ * Between rounds the buffers are applied to the union-find one after another
+ * in ascending order of the relation symbols. Rounds repeat until no relation
+ * reports a pair anymore.
+ *
+ * Since the work of a round does not depend on how it is scheduled, and the
+ * unions are applied in a fixed order, the resulting union-find is exactly
+ * the same for any number of threads. With the concurrent union-find the
+ * buffers are applied in parallel as well, which keeps the canonical ids
+ * since the smallest id of a class always becomes its root. AC and A
+ * relations mutate the e-graph while rebuilding and are therefore rebuilt
+ * serially afterwards.
  */
 class Database
 {
@@ -142,6 +187,15 @@ class Database
     HashMap<Symbol, AbstractRelation> relations;
     HashMap<IndexKey, AbstractIndex> indices;
 
+    // argument multisets of all AC relations, shared with their indices
+    std::shared_ptr<MultisetStore> msets;
+    // multisets left after the last sweep of the store
+    size_t nlive_msets = 0;
+
+    size_t rebuild_threads;
+    bool lazy_flattening = false;
+    ACLimits ac_limits;
+
     AbstractRelation *get_relation(Symbol rel_name)
     {
         auto it = relations.find(rel_name);
@@ -160,7 +214,65 @@ class Database
         return &it->second;
     }
 
+    /**
+     * @brief Sweep the multisets which neither a tuple nor an index refers to anymore
+     */
+    void sweep_multisets();
+
   public:
+    Database();
+
+    /**
+     * @brief Set the number of threads used by rebuild
+     *
+     * Defaults to the hardware concurrency. The result of rebuild is
+     * independent of this setting, only the running time changes.
+     *
+     * @param nthreads Number of threads, 0 and 1 both mean serial
+     */
+    void set_rebuild_threads(size_t nthreads)
+    {
+        rebuild_threads = nthreads;
+    }
+
+    /**
+     * @brief Let all AC relations derive flattened tuples on demand instead of storing them
+     *
+     * Trades matching and rebuilding time for fewer tuples,
+     * see RelationAC. Disabled by default.
+     */
+    void set_lazy_flattening(bool enabled)
+    {
+        lazy_flattening = enabled;
+        for (auto& [_, relation] : relations)
+            if (relation.is_ac())
+                relation.set_lazy_flattening(enabled);
+    }
+
+    /**
+     * @brief Bound the tuples all AC and A relations derive by flattening and unflattening
+     */
+    void set_ac_limits(const ACLimits& limits)
+    {
+        ac_limits = limits;
+        for (auto& [_, relation] : relations)
+            if (relation.is_flattened())
+                relation.set_limits(limits);
+    }
+
+    /**
+     * @brief Sum up how often the ACLimits triggered in all AC and A relations
+     */
+    ACLimitCounters ac_limit_counters() const
+    {
+        ACLimitCounters total;
+        for (const auto& [_, relation] : relations)
+            if (relation.is_flattened())
+                total += relation.limit_counters();
+
+        return total;
+    }
+
     /**
      * @brief Create a new relation in the database
      *
@@ -174,9 +286,56 @@ class Database
         relations.emplace(name, AbstractRelation(RowStore(name, arity)));
     }
 
-    void create_relation_ac(Symbol name, Handle)
+    /**
+     * @brief Create an AC relation
+     *
+     * @param name The operator symbol for the relation
+     * @param idempotent Whether the operator is ACI, see RelationAC
+     */
+    void create_relation_ac(Symbol name, Handle, bool idempotent = false)
     {
-        relations.emplace(name, AbstractRelation(RelationAC(name)));
+        auto [it, inserted] = relations.emplace(name, AbstractRelation(RelationAC(name, msets, idempotent)));
+        if (!inserted)
+            return;
+
+        it->second.set_lazy_flattening(lazy_flattening);
+        it->second.set_limits(ac_limits);
+    }
+
+    /**
+     * @brief Turn an existing AC relation into an ACU relation
+     *
+     * @param name The operator symbol of the AC relation
+     * @param unit The e-class id of the operator's unit
+     */
+    void set_unit(Symbol name, id_t unit)
+    {
+        auto relation = get_relation(name);
+        assert(relation != nullptr && relation->is_ac());
+
+        relation->set_unit(unit);
+    }
+
+    /**
+     * @brief Create a relation for a commutative binary operator
+     *
+     * @param name The operator symbol for the relation
+     */
+    void create_relation_c(Symbol name)
+    {
+        relations.emplace(name, AbstractRelation(RelationC(name)));
+    }
+
+    /**
+     * @brief Create a relation for an associative, non-commutative operator
+     *
+     * @param name The operator symbol for the relation
+     */
+    void create_relation_a(Symbol name)
+    {
+        auto [it, inserted] = relations.emplace(name, AbstractRelation(RelationA(name)));
+        if (inserted)
+            it->second.set_limits(ac_limits);
     }
 
     /**
@@ -197,6 +356,39 @@ class Database
         it->second.add_tuple(tuple);
     }
 
+    /**
+     * @brief Find the e-class of the term `name(args...)`
+     *
+     * @param name The operator symbol of the term
+     * @param args The normalized children of the term, see EGraph::add_enode
+     * @return The e-class id of the term, or nullopt if it is not stored
+     */
+    std::optional<id_t> lookup(Symbol name, const Vec<id_t>& args) const
+    {
+        auto relation = get_relation(name);
+        assert(relation != nullptr && "Relation not found");
+
+        return relation->lookup(args);
+    }
+
+    /**
+     * @brief Call f(symbol, children, nchildren, eclass) for each term of each relation
+     *
+     * AC terms come with their children sorted and repeated according to their
+     * multiplicity. The ids are as stored, canonical right after a rebuild.
+     */
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        for (const auto& entry : relations)
+        {
+            // structured bindings cannot be captured before C++20
+            Symbol symbol = entry.first;
+            entry.second.for_each_term(
+                [&](const id_t *children, size_t nchildren, id_t eclass) { f(symbol, children, nchildren, eclass); });
+        }
+    }
+
     /**
      * @brief Check if a relation exists in the database
      *
@@ -222,8 +414,7 @@ class Database
      */
     AbstractIndex get_index(Symbol name, uint32_t perm) const
     {
-        if (get_relation(name)->is_ac())
-            perm = static_cast<uint32_t>(-1);
+        perm = get_relation(name)->normalize_permutation(perm);
 
         IndexKey key(name, perm);
         auto it = indices.find(key);
@@ -240,8 +431,7 @@ class Database
      */
     bool has_index(Symbol name, uint32_t perm) const
     {
-        if (get_relation(name)->is_ac())
-            perm = static_cast<uint32_t>(-1);
+        perm = get_relation(name)->normalize_permutation(perm);
 
         IndexKey key(name, perm);
         return indices.find(key) != indices.end();
@@ -260,7 +450,9 @@ class Database
      *
      * Delegates to the relation to create and populate the appropriate index type:
      * - RowStore creates a TrieIndex with permuted data
+     * - RelationC creates a CommutativeIndex over its tuples with sorted arguments
      * - RelationAC creates a MultisetIndex (ignores permutation)
+     * - RelationA creates a SequenceIndex (ignores permutation)
      *
      * @param name The operator symbol for the relation to index
      * @param perm The lexicographic permutation index for field ordering
@@ -272,12 +464,11 @@ class Database
     {
         auto relation = get_relation(name);
 
-        if (relation->is_ac())
-            perm = static_cast<uint32_t>(-1);
+        assert(relation != nullptr && "Relation not found");
 
-        IndexKey key{name, perm};
+        perm = relation->normalize_permutation(perm);
 
-        assert(relation != nullptr && "Relation not found");
+        IndexKey key{name, perm};
 
         indices[key] = relation->populate_index(perm);
     }
@@ -285,16 +476,14 @@ class Database
     /**
      * @brief Rebuild all relations by detecting and unifying duplicate entries
      *
-     * Iterates through all relations in the database. For each relation, sorts all
-     * tuples by their first (arity-1) attributes and detects neighboring tuples with
-     * identical arguments but different e-class IDs. When found, calls the unify
-     * callback to merge the e-classes.
+     * Rebuilds the standard relations in parallel rounds until none of them
+     * finds tuples with identical arguments but different e-class IDs anymore
+     * (see "Parallel Rebuild" above), then rebuilds the AC and A relations
+     * serially. Repeats both until a pass does not merge any e-classes, so
+     * a single call leaves the whole database congruence-closed.
      *
-     * @param canonicalize Function to canonicalize an ID
-     * @param unify Function to call when two IDs need to be unified
+     * @param handle Handle to canonicalize and unify e-class ids
      * @return true if any unifications were performed in any relation, false otherwise
-     *
-     * @note For AC relations, rebuild is a no-op
      */
     bool rebuild(Handle handle);
 
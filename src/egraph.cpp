@@ -19,12 +19,23 @@ EGraph::EGraph(const Theory& theory)
     // initialize database with one relation per operator
     for (const auto& [symbol, arity] : theory.operators)
     {
-        if (arity == AC)
-            db.create_relation_ac(symbol, handle());
+        if (arity == AC || arity == ACI)
+            db.create_relation_ac(symbol, handle(), /* idempotent: */ arity == ACI);
+        else if (arity == C)
+            db.create_relation_c(symbol);
+        else if (arity == A)
+            db.create_relation_a(symbol);
         else
             db.create_relation(symbol, arity + 1); // +1 for the id
     }
 
+    // the units of ACU operators are always present
+    for (const auto& [op, unit] : theory.units)
+    {
+        units[op] = add_enode(unit, {});
+        db.set_unit(op, units[op]);
+    }
+
     // compile rewrite rule patterns to queries
     if (!theory.rewrite_rules.empty())
     {
@@ -45,7 +56,7 @@ EGraph::EGraph(const Theory& theory)
             auto required = query.get_required_indices();
             for (auto& [op, perm] : required)
             {
-                if (theory.get_arity(op) == AC)
+                if (theory.is_associative(op))
                     perm = 0;
                 index_set.insert({op, perm});
             }
@@ -88,23 +99,55 @@ id_t EGraph::add_enode(Symbol symbol, Vec<id_t> children)
     return add_enode(std::move(enode));
 }
 
-id_t EGraph::add_enode(ENode enode)
+void EGraph::normalize(ENode& enode) const
 {
     for (auto& child : enode.children)
         child = canonicalize(child);
 
-    if (theory.get_arity(enode.op) == AC)
+    auto unit = units.find(enode.op);
+    if (unit != units.end())
     {
-        std::sort(enode.children.begin(), enode.children.end());
+        id_t id = canonicalize(unit->second);
+        auto& children = enode.children;
+        children.erase(std::remove(children.begin(), children.end(), id), children.end());
     }
 
+    if (theory.is_commutative(enode.op))
+        std::sort(enode.children.begin(), enode.children.end());
+
+    if (theory.is_idempotent(enode.op))
+        enode.children.erase(std::unique(enode.children.begin(), enode.children.end()), enode.children.end());
+}
+
+std::optional<id_t> EGraph::collapse(const ENode& enode) const
+{
+    if (enode.children.size() >= 2)
+        return std::nullopt;
+
+    // op(x, x) = op(x) = x
+    if (enode.children.size() == 1 && theory.is_idempotent(enode.op))
+        return enode.children.front();
+
+    auto unit = units.find(enode.op);
+    if (unit == units.end())
+        return std::nullopt;
+
+    return enode.children.empty() ? canonicalize(unit->second) : enode.children.front();
+}
+
+id_t EGraph::add_enode(ENode enode)
+{
+    normalize(enode);
+
+    if (auto id = collapse(enode))
+        return *id;
+
     // lookup if enode already exists
-    auto it = memo.find(enode);
-    if (it != memo.end())
-        return it->second;
+    if (auto id = db.lookup(enode.op, enode.children))
+        return *id;
 
     // create new eclass-id
-    // and insert into db and memo
+    // and insert into db
     ++enodes;
     id_t id = uf.make_set();
 
@@ -114,22 +157,17 @@ id_t EGraph::add_enode(ENode enode)
     assert(db.has_relation(enode.op));
     db.add_tuple(enode.op, tuple);
 
-    memo[std::move(enode)] = id;
     return id;
 }
 
 std::optional<id_t> EGraph::lookup(ENode enode) const
 {
-    for (auto& id : enode.children)
-        id = canonicalize(id);
+    normalize(enode);
 
-    if (theory.get_arity(enode.op) == AC)
-    {
-        std::sort(enode.children.begin(), enode.children.end());
-    }
+    if (auto id = collapse(enode))
+        return id;
 
-    auto it = memo.find(enode);
-    return it == memo.end() ? std::nullopt : std::optional<id_t>(it->second);
+    return db.lookup(enode.op, enode.children);
 }
 
 id_t EGraph::unify(id_t a, id_t b)
@@ -163,55 +201,35 @@ void EGraph::apply_matches(const Vec<id_t>& matches, Subst& subst)
 
 void EGraph::apply_match(const Vec<id_t>& match, Subst& subst)
 {
-    // Materialize ephemeral IDs in the match vector
-    Vec<id_t> materialized_match = match;
-    for (id_t& id : materialized_match)
-    {
-        // Check if ID is ephemeral (MSB set)
-        if (id & 0x80000000)
-        {
-            auto it = ephemeral_map.find(id);
-            assert(it != ephemeral_map.end());
-            // Materialize: add the enode to get real ID
-            id = add_enode(it->second);
-        }
-    }
+    // Ephemeral ids (MSB set) stand for terms which are not in the e-graph yet.
+    // The subst materializes them on use, or splices the remainders of rest variables.
+    auto resolve = [this](id_t id) -> std::optional<ENode> {
+        if (!(id & 0x80000000))
+            return std::nullopt;
+
+        auto it = ephemeral_map.find(id);
+        assert(it != ephemeral_map.end());
+        return it->second;
+    };
 
     auto callback = [this](Symbol sym, Vec<id_t> children) -> id_t {
         return this->add_enode(sym, std::move(children));
     };
 
-    id_t lhs_id = materialized_match.back(); // root
-    id_t rhs_id = subst.instantiate(callback, materialized_match);
+    // the RHS has no term if it needs an empty remainder of an operator without unit
+    auto rhs_id = subst.instantiate(callback, resolve, match);
+    if (!rhs_id.has_value())
+        return;
+
+    id_t lhs_id = match.back(); // root
+    if (auto enode = resolve(lhs_id))
+        lhs_id = add_enode(*enode);
 
-    unify(lhs_id, rhs_id);
+    unify(lhs_id, *rhs_id);
 }
 
 bool EGraph::rebuild()
 {
-    Vec<std::pair<ENode, id_t>> worklist;
-    for (auto& [enode, id] : memo)
-    {
-        id = canonicalize(id);
-
-        for (auto child : enode.children)
-            if (child != canonicalize(child))
-                worklist.push_back({enode, id});
-    }
-
-    for (auto& [enode, id] : worklist)
-    {
-        memo.erase(enode);
-
-        for (auto& child : enode.children)
-            child = canonicalize(child);
-
-        if (theory.get_arity(enode.op) == AC)
-            std::sort(enode.children.begin(), enode.children.end());
-
-        memo.emplace(enode, id);
-    }
-
     return db.rebuild(handle());
 }
 
@@ -225,6 +243,9 @@ void EGraph::saturate(std::size_t max_iters)
 
     for (std::size_t iter = 0; iter < max_iters; ++iter)
     {
+        // building the indices and matching canonicalize every tuple
+        uf.normalize();
+
         for (const auto& [op_symbol, perm] : required_indices)
             db.populate_index(op_symbol, perm);
 
@@ -248,10 +269,9 @@ void EGraph::saturate(std::size_t max_iters)
 
         db.clear_indices();
         rebuild();
-        rebuild();
 
         std::cout << "iteration: " << iter + 1 << "  eclasses: " << uf.eclasses() << "  enodes: " << db.total_size()
-                  << "  memo: " << memo.size() << std::endl;
+                  << std::endl;
     }
 }
 
@@ -267,27 +287,6 @@ void EGraph::dump_to_file(const std::string& filename) const
 
     db.dump_to_file(out, theory.symbols);
 
-    out << "====<< Hash Cons >>====\n\n";
-
-    out << "size: " << memo.size() << "\n\n";
-
-    for (const auto& [enode, eclass] : memo)
-    {
-        out << "  " << theory.symbols.get_string(enode.op) << "(";
-
-        size_t n = enode.children.size();
-        for (size_t i = 0; i < n; ++i)
-        {
-            out << enode.children[i];
-            if (i < n - 1)
-                out << ", ";
-        }
-
-        out << ") ~~> " << eclass << "\n";
-    }
-
-    out << "\n";
-
     uf.dump_to_file(out);
 
     out.flush();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 
 #include "database.h"
 #include "egraph_di.h"
@@ -10,6 +11,10 @@
 #include "types.h"
 #include "union_find.h"
 
+#ifdef EQSAT_CONCURRENT_UNION_FIND
+#include "concurrent_union_find.h"
+#endif
+
 namespace eqsat
 {
 
@@ -17,9 +22,12 @@ class EGraph
 {
   private:
     Theory theory;
-    Database db; // TODO: flatten database into egraph?
+    Database db; // also the hash-cons, see Database::lookup
+#ifdef EQSAT_CONCURRENT_UNION_FIND
+    ConcurrentUnionFind uf;
+#else
     UnionFind uf;
-    HashMap<ENode, id_t> memo;
+#endif
 
     Vec<Query> queries;
     Vec<Subst> substs;
@@ -27,8 +35,26 @@ class EGraph
 
     HashMap<id_t, ENode> ephemeral_map;
 
+    // ACU operator --> e-class of its unit
+    HashMap<Symbol, id_t> units;
+
     int enodes = 0;
 
+    /**
+     * @brief Canonicalize the children of an enode in place
+     *
+     * Drops the unit from the children of ACU operators, sorts the children
+     * of commutative operators and drops repeated children of ACI operators.
+     */
+    void normalize(ENode& enode) const;
+
+    /**
+     * @brief Get the e-class a normalized ACU or ACI enode with less than two children stands for
+     *
+     * @return The unit for `op()`, the child for `op(x)`, nullopt for all other enodes
+     */
+    std::optional<id_t> collapse(const ENode& enode) const;
+
     Handle handle()
     {
         return Handle(*this);
@@ -78,10 +104,79 @@ class EGraph
     void apply_matches(const Vec<id_t>& matches, Subst& subst);
     void apply_match(const Vec<id_t>& match, Subst& subst);
 
+    /**
+     * @brief Restore the congruence invariant after unifications
+     *
+     * Deferred like in egg, unify only records the merge in the union log.
+     * Rebuilding repairs the terms whose children or e-class got merged,
+     * until no more e-classes merge, so its cost scales with the merges.
+     *
+     * @return true if the database changed
+     */
     bool rebuild();
 
+    /**
+     * @brief Set how unify picks the canonical id of a merged e-class
+     *
+     * Only affects later unifications. Defaults to UnionPolicy::LowestId,
+     * which is the only policy of the concurrent union-find.
+     */
+    void set_union_policy(UnionPolicy policy)
+    {
+        uf.set_policy(policy);
+    }
+
+    /**
+     * @brief Set the number of threads used to rebuild the database
+     *
+     * The rebuilt e-graph is identical for any number of threads.
+     */
+    void set_rebuild_threads(size_t nthreads)
+    {
+        db.set_rebuild_threads(nthreads);
+    }
+
+    /**
+     * @brief Stop materializing flattened AC terms, derive them while matching instead
+     *
+     * Deeply nested AC terms no longer multiply the stored terms, while
+     * matches and equivalences up to associativity are kept.
+     */
+    void set_lazy_flattening(bool enabled)
+    {
+        db.set_lazy_flattening(enabled);
+    }
+
+    /**
+     * @brief Bound the work of flattening and unflattening AC and A terms
+     *
+     * Past a limit some equivalences up to associativity are missed,
+     * in exchange memory and rebuild time stay bounded.
+     */
+    void set_ac_limits(const ACLimits& limits)
+    {
+        db.set_ac_limits(limits);
+    }
+
+    /**
+     * @brief Get how often the AC limits triggered so far
+     */
+    ACLimitCounters ac_limit_counters() const
+    {
+        return db.ac_limit_counters();
+    }
+
     void saturate(size_t max_iters);
 
+    /**
+     * @brief Call f(op, children, nchildren, eclass) for each stored term, see Database::for_each_term
+     */
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        db.for_each_term(f);
+    }
+
     void dump_to_file(const std::string& filename) const;
 };
 
@@ -17,6 +17,11 @@ id_t EGraphLookupDI::lookup_or_ephemeral(ENode enode)
     if (res.has_value())
         return res.value();
 
+    return ephemeral(std::move(enode));
+}
+
+id_t EGraphLookupDI::ephemeral(ENode enode)
+{
     // During pattern matching, we want to know the id of an implicitly stored enode.
     // However, since it is only implicit it doesnt have an assigned id, so instead
     // we temporarily give it an ephemeral id which we remark in the msb of the id.
@@ -51,7 +56,7 @@ id_t EGraphTermBankDI::add_enode(Symbol op, Vec<id_t> children)
 
 bool EGraphTheoryDI::is_ac(Symbol f)
 {
-    return egraph.theory.get_arity(f) == AC;
+    return egraph.theory.is_ac(f);
 }
 
 } // namespace eqsat
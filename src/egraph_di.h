@@ -32,6 +32,7 @@ class EGraphLookupDI
 
     std::optional<id_t> lookup(ENode) const;
     id_t lookup_or_ephemeral(ENode);
+    id_t ephemeral(ENode);
 };
 
 class EGraphEquivalenceDI
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <functional>
 
 #include "engine.h"
@@ -7,9 +8,9 @@
 namespace eqsat
 {
 
-void State::prepare()
+void State::prepare(id_t bound)
 {
-    it = candidates.begin();
+    it = std::lower_bound(candidates.begin(), candidates.end(), bound);
 }
 
 bool State::empty() const
@@ -33,12 +34,21 @@ size_t Engine::intersect(State& state)
 
     if (state.fd != nullptr)
     {
-        auto enode = state.fd->make_enode();
-        auto id = lookup_or_ephemeral(enode);
+        // a fully selected term needs no lookup, which flattened
+        // terms that were never added to the hash-cons rely on
+        auto id = state.fd->selected_eclass();
+        if (!id.has_value())
+            id = lookup_or_ephemeral(state.fd->make_enode());
 
-        sets.emplace_back(AbstractSet(SingletonSet(id)));
+        sets.emplace_back(AbstractSet(SingletonSet(*id)));
     }
 
+    if (state.outer != nullptr)
+        sets.push_back(state.inner->project_owned_by(state.outer->project()));
+
+    for (id_t child : state.ground)
+        sets.push_back(state.inner->project_containing(child));
+
     for (const auto& index : state.indices)
         sets.push_back(index->project());
 
@@ -62,6 +72,10 @@ void Engine::prepare(const Query& query)
         uint32_t permutation = constraint.permutation;
         auto index = db.get_index(constraint.symbol, permutation);
 
+        // terms with fewer children than the pattern are never enumerated
+        if (permutation == static_cast<uint32_t>(AC))
+            index.set_min_size(constraint.nchildren());
+
         indices[constraint] = std::make_shared<AbstractIndex>(index);
 
         for (var_t var : constraint.variables)
@@ -92,10 +106,17 @@ void Engine::prepare(const Query& query)
             auto index_it = indices.find(constraint);
             assert(index_it != indices.end());
 
-            if (var == constraint.variables.back() && constraint.permutation == static_cast<uint32_t>(AC))
+            bool flattened = constraint.permutation == static_cast<uint32_t>(AC) ||
+                             constraint.permutation == static_cast<uint32_t>(A);
+
+            if (var == constraint.variables.back() && flattened)
             {
                 state.fd = index_it->second;
             }
+            else if (constraint.rest && var == constraint.rest_var())
+            {
+                state.rest = index_it->second;
+            }
             else
             {
                 state.indices.push_back(index_it->second);
@@ -104,9 +125,87 @@ void Engine::prepare(const Query& query)
         states.push_back(std::move(state));
     }
 
+    for (const auto& [a, b] : query.symmetries)
+        states[b].lower = a;
+
+    link_nested(query, indices);
+
     // Reset all indices to root before execution
     for (auto& [constraint, index] : indices)
         index->reset();
+
+    resolve_ground(query, indices);
+}
+
+void Engine::link_nested(const Query& query, const HashMap<Constraint, std::shared_ptr<AbstractIndex>>& indices)
+{
+    auto is_ac = [](const Constraint& constraint) { return constraint.permutation == static_cast<uint32_t>(AC); };
+
+    for (const auto& inner : query.constraints)
+    {
+        if (!is_ac(inner))
+            continue;
+
+        var_t eclass = inner.variables.back();
+
+        for (const auto& outer : query.constraints)
+        {
+            if (!is_ac(outer) || &outer == &inner)
+                continue;
+
+            // the children sit between the term-id and the rest variable or e-class id
+            auto first = outer.variables.begin() + 1;
+            auto last = first + outer.nchildren();
+            if (std::find(first, last, eclass) == last)
+                continue;
+
+            // the outer term has to be selected first
+            if (outer.variables.front() > inner.variables.front())
+                continue;
+
+            auto& index = indices.at(inner);
+            if (!inner.rest)
+                index->set_max_size(inner.nchildren());
+
+            auto& state = states[inner.variables.front()];
+            state.outer = indices.at(outer);
+            state.inner = index;
+            break;
+        }
+    }
+}
+
+void Engine::resolve_ground(const Query& query, const HashMap<Constraint, std::shared_ptr<AbstractIndex>>& indices)
+{
+    HashMap<var_t, const Constraint *> constants;
+    for (const auto& constraint : query.constraints)
+        if (constraint.variables.size() == 1 && constraint.permutation != static_cast<uint32_t>(AC) &&
+            constraint.permutation != static_cast<uint32_t>(A))
+            constants[constraint.variables.front()] = &constraint;
+
+    for (const auto& constraint : query.constraints)
+    {
+        if (constraint.permutation != static_cast<uint32_t>(AC))
+            continue;
+
+        auto& state = states[constraint.variables.front()];
+
+        auto first = constraint.variables.begin() + 1;
+        for (auto it = first; it != first + constraint.nchildren(); ++it)
+        {
+            auto constant = constants.find(*it);
+            if (constant == constants.end())
+                continue;
+
+            // the index is at its root, so this yields the e-classes of the constant
+            auto eclasses = indices.at(*constant->second)->project();
+            if (eclasses.size() != 1)
+                continue;
+
+            eclasses.for_each([&state](id_t id) { state.ground.push_back(id); });
+            state.inner = indices.at(constraint);
+        }
+    }
 }
 
 void Engine::execute(Vec<id_t>& results, const Query& query)
@@ -128,10 +227,27 @@ void Engine::execute_rec(Vec<id_t>& results, size_t level)
 
     auto& state = states[level];
 
+    if (state.rest != nullptr)
+    {
+        // The remainder always gets an ephemeral id, even if it exists
+        // in the e-graph already, so that the RHS can splice it.
+        id_t id = ephemeral(state.rest->select_rest());
+
+        state.candidates.clear();
+        state.candidates.insert(id);
+        state.prepare();
+        state.next();
+
+        execute_rec(results, level + 1);
+
+        state.rest->unselect();
+        return;
+    }
+
     // projection & intersection
     intersect(state);
 
-    state.prepare();
+    state.prepare(state.lower.has_value() ? states[*state.lower].current() : 0);
     while (!state.empty())
     {
         id_t cand = state.next();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 
 #include "database.h"
 #include "egraph_di.h"
@@ -20,17 +21,39 @@ struct State
     // There is a function dependency on the ids of each constraint.
     // For example add(x, y; id) has the FD {x,y} --> id
     // meaning there can only be one term 'x + y' and not multiple.
-    // The id is then uniquely determined by memo[(x, y)].
+    // The id is then uniquely determined by the hash-cons entry of (x, y).
     //
     // If this state corresponds to id, we can call
     // lookup on this index rather than project/select.
-    // To perform lookup we reuse the egraphs memo table.
+    // To perform lookup we probe the relation of the constraint.
     //
     // Note that with the current API of compiling pattern expressions,
     // at most one FD can be inferred per variable.
     std::shared_ptr<AbstractIndex> fd = nullptr;
 
-    void prepare();
+    // If this state corresponds to the rest variable of an AC constraint,
+    // it takes all children which are left in this index instead of
+    // enumerating candidates. The remainder is bound to an ephemeral id.
+    std::shared_ptr<AbstractIndex> rest = nullptr;
+
+    // If this state corresponds to the term-id of an AC constraint nested
+    // directly in another AC constraint, e.g. the inner * in (+ (* ?x ?y) ?z),
+    // its e-class has to be a child of the outer term selected before.
+    // Only terms of the inner index owned by one of those children are
+    // enumerated, instead of every term of the inner operator.
+    std::shared_ptr<AbstractIndex> outer = nullptr;
+    std::shared_ptr<AbstractIndex> inner = nullptr;
+
+    // Children of the AC constraint whose term-id this state corresponds to
+    // which are ground, like the (one) in (mul ?x (one)), resolved during
+    // prepare. Only the terms of inner containing all of them are enumerated.
+    Vec<id_t> ground;
+
+    // Symmetry breaking: if set, only candidates which are not smaller
+    // than the current value of this (earlier) variable are enumerated.
+    std::optional<var_t> lower;
+
+    void prepare(id_t bound = 0);
     bool empty() const;
     id_t next();
     id_t current() const;
@@ -43,6 +66,24 @@ class Engine : EGraphLookupDI
     Vec<var_t> head;
     const Database& db;
 
+    /**
+     * @brief Link the term-ids of AC constraints nested in other AC constraints to their outer index
+     *
+     * A match binds the e-class of a nested pattern to a child of the outer
+     * term, so it is always found through a term of exactly that e-class.
+     * Unless the nested pattern has a rest variable, that term has exactly
+     * as many children as the pattern, too.
+     */
+    void link_nested(const Query& query, const HashMap<Constraint, std::shared_ptr<AbstractIndex>>& indices);
+
+    /**
+     * @brief Resolve the constant children of AC constraints to their e-classes
+     *
+     * A child bound by a nullary constraint has a single candidate, known
+     * before any term is selected, see State::ground.
+     */
+    void resolve_ground(const Query& query, const HashMap<Constraint, std::shared_ptr<AbstractIndex>>& indices);
+
   public:
     Engine(const Database& db, EGraph& egraph)
         : EGraphLookupDI(egraph)
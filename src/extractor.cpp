@@ -0,0 +1,231 @@
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "extractor.h"
+#include "utils/parallel.h"
+
+namespace eqsat
+{
+
+namespace
+{
+
+constexpr uint32_t NONE = ~static_cast<uint32_t>(0);
+
+} // namespace
+
+Extractor::Extractor(const EGraph& egraph, CostFunction cost, size_t nthreads)
+    : egraph(egraph)
+{
+    // term --> dense index of its e-class
+    Vec<uint32_t> owners;
+
+    // the cost function is only called here, it need not be thread-safe
+    egraph.for_each_term([&](Symbol op, const id_t *args, size_t nargs, id_t eclass) {
+        double op_cost = cost(op, nargs);
+        if (!(op_cost > 0))
+            throw std::invalid_argument("Extractor: operator costs must be positive");
+
+        auto begin = static_cast<uint32_t>(children.size());
+        for (size_t i = 0; i < nargs; ++i)
+            children.push_back(intern(egraph.canonicalize(args[i])));
+
+        terms.push_back({op, begin, static_cast<uint32_t>(children.size()), op_cost});
+        owners.push_back(intern(egraph.canonicalize(eclass)));
+    });
+
+    // bucket the terms by their e-class
+    size_t nclasses = index.size();
+    offsets.assign(nclasses + 1, 0);
+    for (uint32_t owner : owners)
+        ++offsets[owner + 1];
+
+    for (size_t i = 0; i < nclasses; ++i)
+        offsets[i + 1] += offsets[i];
+
+    Vec<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    class_terms.resize(terms.size());
+    for (uint32_t t = 0; t < terms.size(); ++t)
+        class_terms[fill[owners[t]]++] = t;
+
+    costs.assign(nclasses, INFINITE_COST);
+    choices.assign(nclasses, NONE);
+
+    // components of one level neither share e-classes nor depend on each other
+    for (const auto& level : components())
+        parallel_for(level.size(), nthreads, [&](size_t i) { solve(level[i]); });
+}
+
+uint32_t Extractor::intern(id_t eclass)
+{
+    return index.try_emplace(eclass, static_cast<uint32_t>(index.size())).first->second;
+}
+
+Vec<Vec<Vec<uint32_t>>> Extractor::components() const
+{
+    size_t nclasses = offsets.size() - 1;
+
+    // e-class --> e-classes of the children of its terms
+    Vec<uint32_t> edge_offsets{0};
+    Vec<uint32_t> edges;
+    for (size_t cls = 0; cls < nclasses; ++cls)
+    {
+        for (uint32_t i = offsets[cls]; i < offsets[cls + 1]; ++i)
+        {
+            const Term& term = terms[class_terms[i]];
+            edges.insert(edges.end(), children.begin() + term.begin, children.begin() + term.end);
+        }
+
+        edge_offsets.push_back(static_cast<uint32_t>(edges.size()));
+    }
+
+    // Iterative Tarjan. A component is complete once all components reachable
+    // from it are, so the levels can be assigned right when it is popped.
+    Vec<uint32_t> order(nclasses, NONE);
+    Vec<uint32_t> low(nclasses);
+    Vec<uint32_t> component_of(nclasses, NONE);
+    Vec<uint32_t> component_levels;
+    Vec<bool> on_stack(nclasses, false);
+
+    Vec<uint32_t> stack;
+    // e-class and the position of its next edge
+    Vec<std::pair<uint32_t, uint32_t>> frames;
+
+    Vec<Vec<Vec<uint32_t>>> levels;
+    uint32_t counter = 0;
+
+    auto visit = [&](uint32_t cls) {
+        order[cls] = low[cls] = counter++;
+        stack.push_back(cls);
+        on_stack[cls] = true;
+        frames.push_back({cls, edge_offsets[cls]});
+    };
+
+    for (uint32_t root = 0; root < nclasses; ++root)
+    {
+        if (order[root] != NONE)
+            continue;
+
+        visit(root);
+        while (!frames.empty())
+        {
+            uint32_t cls = frames.back().first;
+            uint32_t edge = frames.back().second;
+
+            if (edge < edge_offsets[cls + 1])
+            {
+                ++frames.back().second;
+
+                uint32_t child = edges[edge];
+                if (order[child] == NONE)
+                    visit(child);
+                else if (on_stack[child])
+                    low[cls] = std::min(low[cls], order[child]);
+
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty())
+            {
+                uint32_t parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[cls]);
+            }
+
+            if (low[cls] != order[cls])
+                continue;
+
+            auto id = static_cast<uint32_t>(component_levels.size());
+
+            Vec<uint32_t> members;
+            uint32_t member;
+            do
+            {
+                member = stack.back();
+                stack.pop_back();
+                on_stack[member] = false;
+                component_of[member] = id;
+                members.push_back(member);
+            } while (member != cls);
+
+            uint32_t level = 0;
+            for (uint32_t m : members)
+                for (uint32_t e = edge_offsets[m]; e < edge_offsets[m + 1]; ++e)
+                    if (component_of[edges[e]] != id)
+                        level = std::max(level, component_levels[component_of[edges[e]]] + 1);
+
+            component_levels.push_back(level);
+            if (levels.size() <= level)
+                levels.resize(level + 1);
+
+            levels[level].push_back(std::move(members));
+        }
+    }
+
+    return levels;
+}
+
+void Extractor::solve(const Vec<uint32_t>& component)
+{
+    // the children outside of the component are final already
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (uint32_t cls : component)
+        {
+            for (uint32_t i = offsets[cls]; i < offsets[cls + 1]; ++i)
+            {
+                const Term& term = terms[class_terms[i]];
+
+                double total = term.cost;
+                for (uint32_t j = term.begin; j < term.end; ++j)
+                    total += costs[children[j]];
+
+                if (total < costs[cls])
+                {
+                    costs[cls] = total;
+                    choices[cls] = class_terms[i];
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+double Extractor::cost(id_t eclass) const
+{
+    auto it = index.find(egraph.canonicalize(eclass));
+    return it == index.end() ? INFINITE_COST : costs[it->second];
+}
+
+std::shared_ptr<Expr> Extractor::extract(id_t eclass) const
+{
+    auto it = index.find(egraph.canonicalize(eclass));
+    if (it == index.end() || costs[it->second] == INFINITE_COST)
+        throw std::runtime_error("Extractor: no finite term in e-class " + std::to_string(eclass));
+
+    HashMap<uint32_t, std::shared_ptr<Expr>> built;
+    return build(it->second, built);
+}
+
+std::shared_ptr<Expr> Extractor::build(uint32_t cls, HashMap<uint32_t, std::shared_ptr<Expr>>& built) const
+{
+    auto it = built.find(cls);
+    if (it != built.end())
+        return it->second;
+
+    // every child of a chosen term is strictly cheaper, so this terminates
+    const Term& term = terms[choices[cls]];
+
+    Vec<std::shared_ptr<Expr>> args;
+    for (uint32_t j = term.begin; j < term.end; ++j)
+        args.push_back(build(children[j], built));
+
+    auto expr = args.empty() ? Expr::make_operator(term.op) : Expr::make_operator(term.op, args);
+    built[cls] = expr;
+    return expr;
+}
+
+} // namespace eqsat
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+
+#include "egraph.h"
+#include "theory.h"
+#include "types.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Extracts a cheapest term of every e-class from a rebuilt e-graph
+ *
+ * The cost of a term is the cost of its operator plus the costs of its
+ * children, and the cost of an operator may depend on its number of children.
+ * AC terms are extracted as they are stored, as one flat n-ary term whose
+ * children repeat according to their multiplicity, so a cost function can
+ * price `mul(a, b, c)` differently from `mul(mul(a, b), c)`, both of which
+ * the relation holds after flattening.
+ *
+ * # Algorithm
+ *
+ * The e-classes form a graph with an edge from every e-class to the children
+ * of its terms. Its strongly connected components are found with Tarjan's
+ * algorithm and levelled, a component on level k only has children on lower
+ * levels or in itself. Level by level the components are solved in parallel:
+ * within a component the costs are relaxed by fixpoint iteration over its
+ * terms until none improves, the costs of the lower levels are final already.
+ *
+ * Operator costs must be positive, which keeps the fixpoint finite and the
+ * extracted terms acyclic. E-classes without a finite term (only cyclic
+ * ones) have infinite cost and cannot be extracted.
+ *
+ * The extractor takes a snapshot of the e-graph when it is constructed,
+ * which should happen right after a rebuild.
+ */
+class Extractor
+{
+  public:
+    /**
+     * @brief Cost of an operator applied to the given number of children
+     */
+    using CostFunction = std::function<double(Symbol op, size_t nchildren)>;
+
+    static constexpr double INFINITE_COST = std::numeric_limits<double>::infinity();
+
+    /**
+     * @brief Counts the operators of a term, AC terms count once however many children they have
+     */
+    static double ast_size(Symbol, size_t)
+    {
+        return 1.0;
+    }
+
+  private:
+    struct Term
+    {
+        Symbol op;
+        // range into children
+        uint32_t begin, end;
+        double cost;
+    };
+
+    const EGraph& egraph;
+
+    // canonical e-class id --> dense index
+    HashMap<id_t, uint32_t> index;
+
+    Vec<Term> terms;
+    // children of all terms, as dense indices
+    Vec<uint32_t> children;
+    // dense index --> range into class_terms
+    Vec<uint32_t> offsets;
+    Vec<uint32_t> class_terms;
+
+    // dense index --> cost and position in terms of its cheapest term
+    Vec<double> costs;
+    Vec<uint32_t> choices;
+
+    uint32_t intern(id_t eclass);
+
+    /**
+     * @brief Group the e-classes into strongly connected components by level
+     *
+     * @return For every level the components on it, each as its dense indices
+     */
+    Vec<Vec<Vec<uint32_t>>> components() const;
+
+    void solve(const Vec<uint32_t>& component);
+
+    std::shared_ptr<Expr> build(uint32_t cls, HashMap<uint32_t, std::shared_ptr<Expr>>& built) const;
+
+  public:
+    /**
+     * @brief Compute the cheapest terms of all e-classes
+     *
+     * @param egraph A rebuilt e-graph
+     * @param cost Cost of each operator application, must be positive
+     * @param nthreads Number of threads which solve the components of a level
+     * @throws std::invalid_argument if the cost function returns a non-positive cost
+     */
+    Extractor(const EGraph& egraph, CostFunction cost = ast_size,
+              size_t nthreads = std::max(1u, std::thread::hardware_concurrency()));
+
+    /**
+     * @brief Get the cost of the cheapest term of an e-class
+     *
+     * @return The cost, or INFINITE_COST if the e-class has no finite term
+     */
+    double cost(id_t eclass) const;
+
+    /**
+     * @brief Extract a cheapest term of an e-class
+     *
+     * Subterms of equal e-classes are shared between the returned expressions.
+     *
+     * @throws std::runtime_error if the e-class has no finite term
+     */
+    std::shared_ptr<Expr> extract(id_t eclass) const;
+};
+
+} // namespace eqsat
@@ -1,5 +1,3 @@
-#include <algorithm>
-
 #include "egraph.h"
 #include "handle.h"
 
@@ -36,19 +34,19 @@ id_t Handle::unify(id_t a, id_t b)
     return egraph.unify(a, b);
 }
 
-id_t Handle::add_enode(ENode enode)
+void Handle::sync_union_log()
 {
-    return egraph.add_enode(std::move(enode));
+    egraph.uf.sync_log();
 }
 
-void Handle::add_enode_to_memo(id_t id, ENode enode)
+const Vec<id_t>& Handle::union_log() const
 {
-    if (egraph.theory.get_arity(enode.op) == AC)
-    {
-        std::sort(enode.children.begin(), enode.children.end());
-    }
+    return egraph.uf.union_log();
+}
 
-    egraph.memo.emplace(std::move(enode), id);
+id_t Handle::add_enode(ENode enode)
+{
+    return egraph.add_enode(std::move(enode));
 }
 
 } // namespace eqsat
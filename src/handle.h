@@ -28,8 +28,17 @@ class Handle
 
     id_t unify(id_t, id_t);
 
+    /**
+     * @brief Bring the union log up to date with all unifications so far
+     *
+     * Must not run concurrently with unify. Afterwards union_log only reads,
+     * so relations can scan it from several threads at once.
+     */
+    void sync_union_log();
+
+    const Vec<id_t>& union_log() const;
+
     id_t add_enode(ENode enode);
-    void add_enode_to_memo(id_t id, ENode enode);
 };
 
 } // namespace eqsat
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cassert>
+#include <optional>
 #include <variant>
 
+#include "indices/commutative_index.h"
 #include "indices/multiset_index.h"
+#include "indices/sequence_index.h"
 #include "indices/trie_index.h"
 #include "types.h"
 
@@ -43,7 +47,7 @@ struct NullIndex
 class AbstractIndex
 {
   private:
-    std::variant<NullIndex, TrieIndex, MultisetIndex> impl;
+    std::variant<NullIndex, TrieIndex, MultisetIndex, SequenceIndex, CommutativeIndex> impl;
 
   public:
     AbstractIndex()
@@ -61,6 +65,16 @@ class AbstractIndex
     {
     }
 
+    explicit AbstractIndex(SequenceIndex index)
+        : impl(std::move(index))
+    {
+    }
+
+    explicit AbstractIndex(CommutativeIndex index)
+        : impl(std::move(index))
+    {
+    }
+
     AbstractIndex(const AbstractIndex& other) = default; // Copy constructor
     AbstractIndex(AbstractIndex&& other) = default;      // Move constructor
 
@@ -91,6 +105,56 @@ class AbstractIndex
     {
         std::visit([](auto& index) { return index.reset(); }, impl);
     }
+
+    void set_min_size(size_t n)
+    {
+        assert(std::holds_alternative<MultisetIndex>(impl));
+        std::get<MultisetIndex>(impl).set_min_size(n);
+    }
+
+    void set_max_size(size_t n)
+    {
+        assert(std::holds_alternative<MultisetIndex>(impl));
+        std::get<MultisetIndex>(impl).set_max_size(n);
+    }
+
+    AbstractSet project_owned_by(const AbstractSet& eclasses) const
+    {
+        assert(std::holds_alternative<MultisetIndex>(impl));
+        return std::get<MultisetIndex>(impl).project_owned_by(eclasses);
+    }
+
+    /**
+     * @brief The e-class of the fully selected term, for indices which know it
+     */
+    std::optional<id_t> selected_eclass() const
+    {
+        if (const auto *index = std::get_if<MultisetIndex>(&impl))
+            return index->selected_eclass();
+
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Mark the multisets the index refers to as live, see MultisetIndex::mark_multisets
+     */
+    void mark_multisets(const MultisetStore& store, Vec<bool>& live) const
+    {
+        if (const auto *index = std::get_if<MultisetIndex>(&impl))
+            index->mark_multisets(store, live);
+    }
+
+    AbstractSet project_containing(id_t child) const
+    {
+        assert(std::holds_alternative<MultisetIndex>(impl));
+        return std::get<MultisetIndex>(impl).project_containing(child);
+    }
+
+    ENode select_rest()
+    {
+        assert(std::holds_alternative<MultisetIndex>(impl));
+        return std::get<MultisetIndex>(impl).select_rest();
+    }
 };
 
 } // namespace eqsat
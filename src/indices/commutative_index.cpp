@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cassert>
+
+#include "commutative_index.h"
+#include "sets/abstract_set.h"
+
+namespace eqsat
+{
+
+namespace
+{
+
+const TrieNode *find_child(const TrieNode *node, id_t key)
+{
+    int index = node->find_key_index(key);
+    return index == -1 ? nullptr : node->children[index].get();
+}
+
+} // namespace
+
+CommutativeIndex::CommutativeIndex(Symbol symbol, std::shared_ptr<TrieNode> root,
+                                   std::shared_ptr<const ArgumentPairs> pairs, Vec<uint32_t> columns)
+    : root(std::move(root))
+    , pairs(std::move(pairs))
+    , columns(std::move(columns))
+    , cursors()
+    , history()
+    , projection()
+    , symbol(symbol)
+{
+    assert(this->columns.size() == 3);
+    assert(this->columns.front() == 2 || this->pairs != nullptr);
+
+    reset();
+}
+
+AbstractSet CommutativeIndex::project()
+{
+    const auto& current = cursors.back();
+    uint32_t column = columns[history.size()];
+
+    if (column == 0 && history.empty()) // first argument at the root
+        return AbstractSet(SortedIterSet(pairs->arguments));
+
+    // a single cursor in the stored order projects like a trie
+    if (column != 0 && current.size() == 1 && !current.front().swapped)
+        return AbstractSet(SortedIterSet(current.front().node->keys));
+
+    projection.clear();
+
+    for (const auto& cursor : current)
+    {
+        const TrieNode *node = cursor.node;
+
+        if (column == 0) // first argument below the e-class, both arguments of its tuples
+        {
+            projection.insert(projection.end(), node->keys.begin(), node->keys.end());
+            for (const auto& child : node->children)
+                projection.insert(projection.end(), child->keys.begin(), child->keys.end());
+        }
+        else if (!cursor.swapped)
+        {
+            projection.insert(projection.end(), node->keys.begin(), node->keys.end());
+        }
+        else if (column == 1)
+        {
+            projection.push_back(cursor.partner);
+        }
+        else // e-class between the arguments, only of tuples which reach the larger argument
+        {
+            for (size_t i = 0; i < node->keys.size(); ++i)
+                if (find_child(node->children[i].get(), cursor.pending) != nullptr)
+                    projection.push_back(node->keys[i]);
+        }
+    }
+
+    std::sort(projection.begin(), projection.end());
+    projection.erase(std::unique(projection.begin(), projection.end()), projection.end());
+
+    return AbstractSet(SortedIterSet(projection));
+}
+
+void CommutativeIndex::select(id_t key)
+{
+    uint32_t column = columns[history.size()];
+
+    Vec<Cursor> next;
+    for (const auto& cursor : cursors.back())
+    {
+        if (cursor.swapped)
+        {
+            if (column == 1)
+            {
+                if (cursor.partner == key)
+                    next.push_back({find_child(cursor.node, cursor.pending), false, 0, 0});
+            }
+            else if (const TrieNode *child = find_child(cursor.node, key))
+            {
+                if (find_child(child, cursor.pending) != nullptr)
+                    next.push_back({child, true, cursor.partner, cursor.pending});
+            }
+
+            continue;
+        }
+
+        if (const TrieNode *child = find_child(cursor.node, key))
+            next.push_back({child, false, 0, 0});
+
+        if (column != 0)
+            continue;
+
+        // key as the larger argument, wait below each of its smaller partners
+        if (history.empty())
+        {
+            auto it = std::lower_bound(pairs->keys.begin(), pairs->keys.end(), key);
+            if (it == pairs->keys.end() || *it != key)
+                continue;
+
+            size_t i = std::distance(pairs->keys.begin(), it);
+            for (uint32_t j = pairs->offsets[i]; j < pairs->offsets[i + 1]; ++j)
+                next.push_back({find_child(cursor.node, pairs->partners[j]), true, pairs->partners[j], key});
+        }
+        else
+        {
+            for (size_t i = 0; i < cursor.node->keys.size() && cursor.node->keys[i] < key; ++i)
+                if (find_child(cursor.node->children[i].get(), key) != nullptr)
+                    next.push_back({cursor.node->children[i].get(), true, cursor.node->keys[i], key});
+        }
+    }
+
+    assert(!next.empty());
+
+    cursors.push_back(std::move(next));
+    history.push_back(key);
+}
+
+void CommutativeIndex::unselect()
+{
+    assert(!history.empty());
+
+    cursors.pop_back();
+    history.pop_back();
+}
+
+ENode CommutativeIndex::make_enode()
+{
+    return ENode(symbol, history);
+}
+
+void CommutativeIndex::reset()
+{
+    history.clear();
+    cursors.clear();
+    cursors.push_back({{root.get(), false, 0, 0}});
+}
+
+} // namespace eqsat
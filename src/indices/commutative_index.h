@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+
+#include "indices/trie_index.h"
+#include "sets/abstract_set.h"
+#include "types.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Argument pairs of a commutative relation, keyed by the larger argument
+ *
+ * Complements a trie whose first level holds the smaller arguments of the
+ * sorted tuples. The smaller partners of keys[i] are the ids in
+ * `partners[offsets[i] .. offsets[i + 1])`, in ascending order. Tuples with
+ * two equal arguments have no larger argument and are left out.
+ */
+struct ArgumentPairs
+{
+    Vec<id_t> keys;
+    Vec<uint32_t> offsets;
+    Vec<id_t> partners;
+    // every id which is an argument of some tuple, in ascending order
+    Vec<id_t> arguments;
+};
+
+/**
+ * @brief Index over the tuples of a commutative binary operator, see RelationC
+ *
+ * The index holds a single trie over the tuples with sorted arguments, the
+ * smaller argument on the level of the first argument column. Its argument
+ * levels project the union of both argument orders: the first one yields
+ * every argument, and once an argument x is selected, the second one yields
+ * the partners of x on either side of the stored tuples.
+ *
+ * The traversal keeps one cursor per trie node which still agrees with the
+ * selected keys. A cursor in the stored order descends like in a TrieIndex.
+ * A cursor in the swapped order has selected x as the larger argument, so it
+ * waits below one of the smaller partners of x until the second argument
+ * level selects that partner, and only then descends to x. The partners of x
+ * come from the ArgumentPairs when the arguments are the first columns, and
+ * from the few tuples of the selected e-class otherwise.
+ */
+class CommutativeIndex
+{
+  private:
+    struct Cursor
+    {
+        const TrieNode *node;
+        // set until a cursor in the swapped order has descended to its larger argument
+        bool swapped;
+        // the smaller argument, which the second argument level has to select
+        id_t partner;
+        // the larger argument, selected on the first argument level
+        id_t pending;
+    };
+
+    std::shared_ptr<TrieNode> root;
+    // only needed if the trie starts with the arguments
+    std::shared_ptr<const ArgumentPairs> pairs;
+    // column of each trie level, the sorted arguments are 0 and 1, the e-class 2
+    Vec<uint32_t> columns;
+    // cursors agreeing with the history, one level per selected key plus the root
+    Vec<Vec<Cursor>> cursors;
+    Vec<id_t> history;
+    // sorted union of the keys of several cursors, backs the projected set
+    Vec<id_t> projection;
+    Symbol symbol;
+
+  public:
+    CommutativeIndex(Symbol symbol, std::shared_ptr<TrieNode> root, std::shared_ptr<const ArgumentPairs> pairs,
+                     Vec<uint32_t> columns);
+
+    AbstractSet project();
+    void select(id_t key);
+    void unselect();
+    ENode make_enode();
+    void reset();
+};
+
+} // namespace eqsat
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cassert>
+
 #include "multiset_index.h"
 #include "sets/abstract_set.h"
 #include "sets/hashmap_wrapper.h"
@@ -6,32 +9,138 @@
 namespace eqsat
 {
 
+MultisetIndex::MultisetIndex(Symbol symbol, const HashMap<id_t, Multiset>& data)
+    : history()
+    , mset()
+    , rest()
+    , unit()
+    , order()
+    , term(0)
+    , min_size(0)
+    , max_size(SIZE_MAX)
+    , symbol(symbol)
+{
+    auto owned_store = std::make_shared<MultisetStore>();
+    auto owned_terms = std::make_shared<HashMap<id_t, mset_id_t>>();
+
+    for (const auto& [term_id, children] : data)
+        owned_terms->insert({term_id, owned_store->intern(children)});
+
+    store = std::move(owned_store);
+    terms = std::move(owned_terms);
+}
+
+std::pair<id_t, id_t> MultisetIndex::term_range() const
+{
+    auto n = static_cast<id_t>(order->ids.size());
+    if (unit.has_value())
+        return {0, n};
+
+    const auto& sizes = order->sizes;
+    auto first_with = [&](size_t size) { return size < sizes.size() ? sizes[size] : n; };
+
+    id_t first = first_with(min_size);
+    id_t last = max_size == SIZE_MAX ? n : first_with(max_size + 1);
+
+    return {first, std::max(first, last)};
+}
+
+AbstractSet MultisetIndex::project_terms() const
+{
+    if (order == nullptr)
+        return AbstractSet(WrappedHashMapSet(*terms));
+
+    auto [first, last] = term_range();
+    return AbstractSet(SortedIterSet(order->ids.begin() + first, order->ids.begin() + last));
+}
+
 AbstractSet MultisetIndex::project()
 {
     if (!mset.has_value()) // term-id
     {
-        return AbstractSet(WrappedHashMapSet(data));
+        return project_terms();
     }
-    else if (!mset.value()->empty()) // children...
+    else if (!mset->empty() || unit.has_value()) // children...
     {
-        const Multiset& cref = *mset.value();
-        return AbstractSet(MultisetSupport(cref));
+        return AbstractSet(MultisetSupport(*mset, unit));
     }
 
     return AbstractSet();
 }
 
+AbstractSet MultisetIndex::project_owned_by(const AbstractSet& eclasses) const
+{
+    assert(!mset.has_value());
+
+    if (order == nullptr || unit.has_value())
+        return project_terms();
+
+    auto [first, last] = term_range();
+
+    Vec<id_t> owned;
+    eclasses.for_each([&](id_t eclass) {
+        auto it = order->owners.find(eclass);
+        if (it == order->owners.end())
+            return;
+
+        auto begin = std::lower_bound(it->second.begin(), it->second.end(), first);
+        auto end = std::lower_bound(begin, it->second.end(), last);
+        owned.insert(owned.end(), begin, end);
+    });
+
+    // every term has a single e-class, so there are no duplicates
+    std::sort(owned.begin(), owned.end());
+
+    SortedVecSet result;
+    for (id_t term_id : owned)
+        result.insert(term_id);
+
+    return AbstractSet(std::move(result));
+}
+
+AbstractSet MultisetIndex::project_containing(id_t child) const
+{
+    assert(!mset.has_value());
+
+    if (order == nullptr || child == unit)
+        return project_terms();
+
+    auto it = order->occurrences.find(child);
+    if (it == order->occurrences.end())
+        return AbstractSet();
+
+    auto [first, last] = term_range();
+
+    auto begin = std::lower_bound(it->second.begin(), it->second.end(), first);
+    auto end = std::lower_bound(begin, it->second.end(), last);
+    return AbstractSet(SortedIterSet(begin, end));
+}
+
 void MultisetIndex::select(id_t key)
 {
     if (!mset.has_value()) // term-id
     {
-        mset = &data.at(key);
+        // the store is shared with the relation, so work on a copy
+        auto it = terms->find(key);
+        if (it != terms->end())
+            mset = store->get(it->second);
+        else
+            mset = derived_store->get(derived_terms->at(key));
+
+        term = key;
         return;
     }
 
     auto& args = mset.value();
 
-    if (args->empty())
+    // the unit can be selected any number of times without using up a child
+    if (key == unit)
+    {
+        history.push_back(key);
+        return;
+    }
+
+    if (args.empty())
         return;
 
     history.push_back(key);
@@ -39,12 +148,36 @@ void MultisetIndex::select(id_t key)
     // We search in the multiset for this key and decrement its counter.
     // This means we have temporarily removed it from the set.
     // In order to later "unselect" this key, we've added it to the history.
-    args->remove(key);
+    args.remove(key);
+}
+
+ENode MultisetIndex::select_rest()
+{
+    assert(mset.has_value() && !rest.has_value());
+
+    Vec<id_t> children = mset->collect();
+
+    rest = history.size();
+    for (id_t child : children)
+    {
+        history.push_back(child);
+        mset->remove(child);
+    }
+
+    return ENode(symbol, children);
 }
 
 void MultisetIndex::unselect()
 {
-    if (history.empty()) // term-id
+    if (rest.has_value()) // rest variable
+    {
+        for (size_t i = *rest; i < history.size(); ++i)
+            mset->insert(history[i]);
+
+        history.resize(*rest);
+        rest = std::nullopt;
+    }
+    else if (history.empty()) // term-id
     {
         mset = std::nullopt;
     }
@@ -52,7 +185,9 @@ void MultisetIndex::unselect()
     {
         auto key = history.back();
         history.pop_back();
-        mset.value()->insert(key);
+
+        if (key != unit)
+            mset->insert(key);
     }
 }
 
@@ -63,15 +198,10 @@ ENode MultisetIndex::make_enode()
 
 void MultisetIndex::reset()
 {
-    // Restore all removed elements
-    while (!history.empty())
-    {
-        auto key = history.back();
-        history.pop_back();
-        mset.value()->insert(key);
-    }
-
+    // the scratch copy is simply dropped
+    history.clear();
     mset = std::nullopt;
+    rest = std::nullopt;
 }
 
 } // namespace eqsat
@@ -1,37 +1,194 @@
 #pragma once
 
+#include <cassert>
+#include <memory>
 #include <optional>
 
 #include "../sets/abstract_set.h"
 #include "../utils/multiset.h"
+#include "../utils/multiset_store.h"
 #include "types.h"
 
 namespace eqsat
 {
 
+/**
+ * @brief The terms of a RelationAC as laid out for its indices
+ *
+ * Term-ids are dense and ascend with the size of their multisets.
+ */
+struct TermOrder
+{
+    // all term-ids in ascending order
+    Vec<id_t> ids;
+    // size s --> first term-id whose term has at least s children
+    Vec<uint32_t> sizes;
+    // term-id --> e-class of the term
+    Vec<id_t> eclasses;
+    // e-class --> ascending term-ids of the terms in that e-class
+    HashMap<id_t, Vec<id_t>> owners;
+    // child e-class --> ascending term-ids of the terms containing it
+    HashMap<id_t, Vec<id_t>> occurrences;
+};
+
 class MultisetIndex
 {
   private:
     // term-id < children... [ < eclass-id ]
     Vec<id_t> history;
-    HashMap<id_t, Multiset> data;
-    std::optional<Multiset *> mset;
+    std::shared_ptr<const MultisetStore> store;
+    // term-id --> interned multiset of its children
+    std::shared_ptr<const HashMap<id_t, mset_id_t>> terms;
+    // terms which only exist in this index, with their multisets in a store of their own
+    std::shared_ptr<const MultisetStore> derived_store;
+    std::shared_ptr<const HashMap<id_t, mset_id_t>> derived_terms;
+    // scratch copy of the children of the selected term
+    std::optional<Multiset> mset;
+    // start of the rest variable's children in the history, if bound
+    std::optional<size_t> rest;
+    // e-class of the unit of an ACU operator, which every term implicitly contains
+    std::optional<id_t> unit;
+    // size order and postings of the terms, if the relation provides them
+    std::shared_ptr<const TermOrder> order;
+    // the selected term
+    id_t term;
+    // terms with fewer or more children cannot match
+    size_t min_size;
+    size_t max_size;
     Symbol symbol;
 
+    /**
+     * @brief Get the range of term-ids within the size limits
+     */
+    std::pair<id_t, id_t> term_range() const;
+
+    AbstractSet project_terms() const;
+
   public:
-    MultisetIndex(Symbol symbol, const HashMap<id_t, Multiset> data)
+    MultisetIndex(Symbol symbol, std::shared_ptr<const MultisetStore> store,
+                  std::shared_ptr<const HashMap<id_t, mset_id_t>> terms, std::optional<id_t> unit = std::nullopt,
+                  std::shared_ptr<const TermOrder> order = nullptr)
         : history()
-        , data(data)
+        , store(std::move(store))
+        , terms(std::move(terms))
+        , derived_store()
+        , derived_terms()
         , mset()
+        , rest()
+        , unit(unit)
+        , order(std::move(order))
+        , term(0)
+        , min_size(0)
+        , max_size(SIZE_MAX)
         , symbol(symbol)
     {
     }
 
+    /**
+     * @brief Build an index over a private store holding the given multisets
+     */
+    MultisetIndex(Symbol symbol, const HashMap<id_t, Multiset>& data);
+
+    /**
+     * @brief Add terms which only exist in this index, like lazily flattened ones
+     *
+     * Their multisets are interned in a store owned by the index instead of
+     * the shared one, so they are dropped together with the index.
+     *
+     * @pre The index has a term order listing the derived terms
+     */
+    void set_derived_terms(std::shared_ptr<const MultisetStore> derived_store,
+                           std::shared_ptr<const HashMap<id_t, mset_id_t>> derived_terms)
+    {
+        assert(order != nullptr);
+        this->derived_store = std::move(derived_store);
+        this->derived_terms = std::move(derived_terms);
+    }
+
+    /**
+     * @brief Only enumerate terms with at least n children
+     *
+     * Takes effect if the term-ids are ordered by size and there is no unit,
+     * which would stand in for any missing children.
+     */
+    void set_min_size(size_t n)
+    {
+        min_size = n;
+    }
+
+    /**
+     * @brief Only enumerate terms with at most n children, see set_min_size
+     */
+    void set_max_size(size_t n)
+    {
+        max_size = n;
+    }
+
     AbstractSet project();
+
+    /**
+     * @brief Project the term-ids of the terms whose e-class is in eclasses
+     *
+     * A semijoin for AC patterns nested in AC patterns, where the e-class of
+     * the inner term has to be a child of the outer one. Respects the size
+     * limits. Without the term order, or with a unit, which lets a match
+     * collapse into an e-class without any term, this is the same as project.
+     *
+     * @pre No term is selected
+     */
+    AbstractSet project_owned_by(const AbstractSet& eclasses) const;
+
+    /**
+     * @brief Project the term-ids of the terms which contain the given child
+     *
+     * Lets a pattern with a ground child start from the posting list of that
+     * child instead of from all terms. Respects the size limits. Without the
+     * term order, or if the child is the unit, this is the same as project.
+     *
+     * @pre No term is selected
+     */
+    AbstractSet project_containing(id_t child) const;
+
+    /**
+     * @brief Mark the multisets of all terms as live, if they are interned in the given store
+     *
+     * @param live One flag per multiset id of the store, see MultisetStore::sweep
+     */
+    void mark_multisets(const MultisetStore& owner, Vec<bool>& live) const
+    {
+        if (store.get() != &owner)
+            return;
+
+        for (const auto& [_, mset] : *terms)
+            live[mset] = true;
+    }
+
+    /**
+     * @brief Get the e-class of the selected term once all of its children are selected
+     *
+     * @return The e-class, or nullopt if children are left or the term order is unknown
+     */
+    std::optional<id_t> selected_eclass() const
+    {
+        if (order == nullptr || !mset.has_value() || mset->size() > 0)
+            return std::nullopt;
+
+        return order->eclasses[term];
+    }
+
     void select(id_t key);
     void unselect();
     ENode make_enode();
     void reset();
+
+    /**
+     * @brief Select all children which are left, for binding a rest variable
+     *
+     * Undone by a single unselect.
+     *
+     * @return The remaining children under this index's operator
+     */
+    ENode select_rest();
 };
 
 } // namespace eqsat
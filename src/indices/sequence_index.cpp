@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cassert>
+
+#include "sequence_index.h"
+#include "sets/abstract_set.h"
+
+namespace eqsat
+{
+
+SequenceIndex::SequenceIndex(Symbol symbol, std::shared_ptr<const Vec<Sequence>> sequences)
+    : history()
+    , sequences(std::move(sequences))
+    , sequence(nullptr)
+    , starts()
+    , projection()
+    , symbol(symbol)
+{
+    auto all = std::make_shared<Vec<id_t>>();
+    for (size_t pos = 0; pos < this->sequences->size(); ++pos)
+        if ((*this->sequences)[pos] != nullptr)
+            all->push_back(static_cast<id_t>(pos));
+
+    terms = std::move(all);
+}
+
+AbstractSet SequenceIndex::project()
+{
+    if (sequence == nullptr) // term-id
+        return AbstractSet(SortedIterSet(*terms));
+
+    projection.clear();
+
+    if (starts.empty()) // first child, any window
+    {
+        projection.assign(sequence->begin(), sequence->end());
+    }
+    else // further children, right after the current windows
+    {
+        size_t offset = history.size();
+        for (uint32_t start : starts.back())
+            if (start + offset < sequence->size())
+                projection.push_back((*sequence)[start + offset]);
+    }
+
+    std::sort(projection.begin(), projection.end());
+    projection.erase(std::unique(projection.begin(), projection.end()), projection.end());
+
+    return AbstractSet(SortedIterSet(projection));
+}
+
+void SequenceIndex::select(id_t key)
+{
+    if (sequence == nullptr) // term-id
+    {
+        sequence = (*sequences)[key].get();
+        return;
+    }
+
+    Vec<uint32_t> matching;
+    if (starts.empty())
+    {
+        for (uint32_t i = 0; i < sequence->size(); ++i)
+            if ((*sequence)[i] == key)
+                matching.push_back(i);
+    }
+    else
+    {
+        size_t offset = history.size();
+        for (uint32_t start : starts.back())
+            if (start + offset < sequence->size() && (*sequence)[start + offset] == key)
+                matching.push_back(start);
+    }
+
+    assert(!matching.empty());
+
+    starts.push_back(std::move(matching));
+    history.push_back(key);
+}
+
+void SequenceIndex::unselect()
+{
+    if (history.empty()) // term-id
+    {
+        sequence = nullptr;
+    }
+    else // children...
+    {
+        history.pop_back();
+        starts.pop_back();
+    }
+}
+
+ENode SequenceIndex::make_enode()
+{
+    return ENode(symbol, history);
+}
+
+void SequenceIndex::reset()
+{
+    history.clear();
+    starts.clear();
+    sequence = nullptr;
+}
+
+} // namespace eqsat
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+
+#include "../sets/abstract_set.h"
+#include "types.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Argument sequence of an associative term, immutable once shared
+ */
+using Sequence = std::shared_ptr<const Vec<id_t>>;
+
+/**
+ * @brief Index over the argument sequences of an associative operator
+ *
+ * Matching an A-pattern `op(x1, ..., xk)` against a term selects a contiguous
+ * window of k children of the term, left to right. After selecting the term-id
+ * the index tracks the start positions of all windows which agree with the
+ * children selected so far, so each further child is projected from the
+ * element right after those windows.
+ *
+ * The index works on a snapshot of the sequence pointers of the relation.
+ * The relation replaces a sequence instead of changing it, so the snapshot
+ * keeps seeing the relation as of the creation of the index. Positions
+ * without a sequence hold no term.
+ */
+class SequenceIndex
+{
+  private:
+    // term-id < children... [ < eclass-id ]
+    Vec<id_t> history;
+    // term-id --> sequence of its children, shared with the relation
+    std::shared_ptr<const Vec<Sequence>> sequences;
+    // all term-ids with a sequence in ascending order
+    std::shared_ptr<const Vec<id_t>> terms;
+    // children of the selected term, nullptr while no term is selected
+    const Vec<id_t> *sequence;
+    // start positions of the windows matching the history, one level per selected child
+    Vec<Vec<uint32_t>> starts;
+    // sorted children which can extend the windows, backs the projected set
+    Vec<id_t> projection;
+    Symbol symbol;
+
+  public:
+    SequenceIndex(Symbol symbol, std::shared_ptr<const Vec<Sequence>> sequences);
+
+    AbstractSet project();
+    void select(id_t key);
+    void unselect();
+    ENode make_enode();
+    void reset();
+};
+
+} // namespace eqsat
@@ -20,7 +20,8 @@ bool Parser::is_whitespace(char c)
 
 bool Parser::is_identifier_char(char c)
 {
-    return std::isalnum(c) || c == '_' || c == '-' || c == '+' || c == '*' || c == '/' || c == '?' || c == '=';
+    return std::isalnum(c) || c == '_' || c == '-' || c == '+' || c == '*' || c == '/' || c == '?' || c == '=' ||
+           c == '.';
 }
 
 std::vector<Token> Parser::tokenize(const std::string& input)
@@ -120,8 +121,20 @@ std::shared_ptr<Expr> Parser::parse_expr()
         }
         // Remove the '?' prefix and intern the variable name
         std::string var_name = token.value.substr(1);
+
+        // Rest variable: ?identifier...
+        bool rest = var_name.size() >= 3 && var_name.compare(var_name.size() - 3, 3, "...") == 0;
+        if (rest)
+        {
+            var_name.resize(var_name.size() - 3);
+            if (var_name.empty())
+            {
+                throw std::runtime_error("Variable name cannot be empty before '...'");
+            }
+        }
+
         Symbol var_sym = symbols.intern(var_name);
-        return Expr::make_variable(var_sym);
+        return rest ? Expr::make_rest_variable(var_sym) : Expr::make_variable(var_sym);
     }
 
     // Operator: (op arg1 arg2 ...)
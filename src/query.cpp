@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cassert>
 
 #include "query.h"
 #include "utils/permutation.h"
@@ -71,25 +72,80 @@ void Query::add_head_var(var_t var)
     head.push_back(var);
 }
 
-id_t Subst::instantiate(callback_t f, const Vec<id_t>& match)
+std::optional<id_t> Subst::instantiate(callback_t f, const Vec<id_t>& match)
 {
-    return instantiate_rec(f, match, root);
+    return instantiate(f, [](id_t) { return std::nullopt; }, match);
 }
 
-id_t Subst::instantiate_rec(callback_t f, const Vec<id_t>& match, std::shared_ptr<Expr> expr)
+std::optional<id_t> Subst::instantiate(callback_t f, resolve_t resolve, const Vec<id_t>& match)
+{
+    return instantiate_rec(f, resolve, match, root);
+}
+
+std::optional<id_t> Subst::instantiate_remainder(callback_t f, Symbol op, Vec<id_t> children)
+{
+    if (children.size() == 1)
+        return children[0];
+
+    if (children.empty())
+    {
+        auto unit = units.find(op);
+        if (unit == units.end())
+            return std::nullopt;
+
+        return f(unit->second, {});
+    }
+
+    return f(op, std::move(children));
+}
+
+std::optional<id_t> Subst::instantiate_rec(callback_t f, resolve_t resolve, const Vec<id_t>& match,
+                                           std::shared_ptr<Expr> expr)
 {
     if (expr->is_variable())
-        return match[env[expr->symbol]];
+    {
+        id_t id = match[env[expr->symbol]];
+
+        if (auto enode = resolve(id))
+        {
+            if (rests.contains(expr->symbol))
+                return instantiate_remainder(f, enode->op, std::move(enode->children));
+
+            return f(enode->op, std::move(enode->children));
+        }
+
+        return id;
+    }
 
     Vec<id_t> children;
     children.reserve(expr->nchildren());
 
+    bool spliced = false;
     for (auto child : expr->children)
     {
-        id_t child_id = instantiate_rec(f, match, child);
-        children.push_back(child_id);
+        if (child->is_variable() && rests.contains(child->symbol))
+        {
+            auto enode = resolve(match[env[child->symbol]]);
+
+            // splice the remainder bound by a rest variable
+            if (enode.has_value() && enode->op == expr->symbol)
+            {
+                children.insert(children.end(), enode->children.begin(), enode->children.end());
+                spliced = true;
+                continue;
+            }
+        }
+
+        auto child_id = instantiate_rec(f, resolve, match, child);
+        if (!child_id.has_value())
+            return std::nullopt;
+
+        children.push_back(*child_id);
     }
 
+    if (spliced)
+        return instantiate_remainder(f, expr->symbol, std::move(children));
+
     return f(expr->symbol, std::move(children));
 }
 
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <memory>
+#include <optional>
 
 #include "symbol_table.h"
 #include "theory.h"
@@ -38,6 +39,34 @@ class Constraint
     /** @brief List of variables participating in this constraint */
     Vec<var_t> variables;
 
+    /**
+     * @brief Set for AC constraints whose last child variable is a rest variable
+     *
+     * The rest variable binds all children which are not selected
+     * by the other child variables, see Expr::is_rest().
+     */
+    bool rest = false;
+
+    /**
+     * @brief Get the rest variable of this constraint
+     *
+     * @pre rest is set
+     */
+    var_t rest_var() const
+    {
+        return variables[variables.size() - 2];
+    }
+
+    /**
+     * @brief Get the number of child variables of an AC or A constraint
+     *
+     * Neither the term-id, the rest variable nor the e-class id are counted.
+     */
+    size_t nchildren() const
+    {
+        return variables.size() - 2 - (rest ? 1 : 0);
+    }
+
     /**
      * @brief Construct a new constraint
      *
@@ -57,7 +86,7 @@ class Constraint
 
     bool operator==(const Constraint& other) const
     {
-        return symbol == other.symbol && variables == other.variables;
+        return symbol == other.symbol && variables == other.variables && rest == other.rest;
     }
 };
 
@@ -85,6 +114,15 @@ class Query
 
     var_t nvars = 0;
 
+    /**
+     * @brief Symmetry breaking constraints (a, b) with a < b
+     *
+     * Each pair requires the value bound to b to be at least the value
+     * bound to a. Only emitted for interchangeable variables, for which
+     * the other orderings would produce the same instantiated RHS.
+     */
+    Vec<std::pair<var_t, var_t>> symmetries;
+
     /**
      * @brief Construct an empty query with a name
      *
@@ -138,6 +176,22 @@ class Query
 };
 
 using callback_t = function<id_t(Symbol, Vec<id_t>)>;
+
+// Returns the not yet materialized e-node behind an ephemeral id, if any
+using resolve_t = function<std::optional<ENode>(id_t)>;
+
+/**
+ * @brief Template for instantiating the RHS of a rule with a match
+ *
+ * Variables bound to an ephemeral e-node are materialized on use, with one
+ * exception: a rest variable, which is bound to an ephemeral `op(children...)`
+ * holding the remainder, gets its children spliced in place when it appears as
+ * a child of the same operator `op`. An operator application which ends up
+ * with a single child after splicing, as well as a remainder with a single
+ * child, stands for that child. With no child left it stands for the unit of
+ * an ACU operator, other operators have no term without children, so the
+ * instantiation fails and the match has to be skipped.
+ */
 class Subst
 {
   public:
@@ -145,18 +199,36 @@ class Subst
     size_t head_size;
     shared_ptr<Expr> root;
     HashMap<Symbol, int> env;
+    // the rest variables of the LHS
+    HashSet<Symbol> rests;
+    // AC operator --> its unit, which an empty remainder stands for
+    HashMap<Symbol, Symbol> units;
 
-    id_t instantiate_rec(callback_t f, const Vec<id_t>& match, shared_ptr<Expr> expr);
+    std::optional<id_t> instantiate_rec(callback_t f, resolve_t resolve, const Vec<id_t>& match,
+                                        shared_ptr<Expr> expr);
 
-    Subst(Symbol name, shared_ptr<Expr> root, HashMap<Symbol, int> env, size_t head_size)
+    /**
+     * @brief Instantiate a remainder of the given children, see above
+     */
+    std::optional<id_t> instantiate_remainder(callback_t f, Symbol op, Vec<id_t> children);
+
+    Subst(Symbol name, shared_ptr<Expr> root, HashMap<Symbol, int> env, size_t head_size,
+          HashSet<Symbol> rests = {}, HashMap<Symbol, Symbol> units = {})
         : name(name)
         , head_size(head_size)
         , root(root)
         , env(env)
+        , rests(std::move(rests))
+        , units(std::move(units))
     {
     }
 
-    id_t instantiate(callback_t f, const Vec<id_t>& match);
+    /**
+     * @return The e-class of the instantiated RHS, or nullopt if an empty
+     *         remainder of an operator without unit leaves no term
+     */
+    std::optional<id_t> instantiate(callback_t f, const Vec<id_t>& match);
+    std::optional<id_t> instantiate(callback_t f, resolve_t resolve, const Vec<id_t>& match);
 };
 
 } // namespace eqsat
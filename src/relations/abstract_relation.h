@@ -1,12 +1,17 @@
 #pragma once
 
+#include <cassert>
 #include <cstddef>
 #include <fstream>
+#include <optional>
+#include <utility>
 #include <variant>
 
 #include "handle.h"
 #include "indices/abstract_index.h"
+#include "relations/relation_a.h"
 #include "relations/relation_ac.h"
+#include "relations/relation_c.h"
 #include "relations/row_store.h"
 #include "symbol_table.h"
 
@@ -16,7 +21,7 @@ namespace eqsat
 class AbstractRelation
 {
   private:
-    std::variant<RowStore, RelationAC> impl;
+    std::variant<RowStore, RelationAC, RelationC, RelationA> impl;
 
   public:
     explicit AbstractRelation(RowStore rel)
@@ -29,6 +34,16 @@ class AbstractRelation
     {
     }
 
+    explicit AbstractRelation(RelationC rel)
+        : impl(std::move(rel))
+    {
+    }
+
+    explicit AbstractRelation(RelationA rel)
+        : impl(std::move(rel))
+    {
+    }
+
     AbstractRelation(const AbstractRelation&) = default;
     AbstractRelation(AbstractRelation&&) = default;
 
@@ -50,6 +65,23 @@ class AbstractRelation
         std::visit([&tuple](auto& rel) { rel.add_tuple(tuple); }, impl);
     }
 
+    /**
+     * @brief Find the e-class of the term with the given arguments in the relation's hash-cons
+     */
+    std::optional<id_t> lookup(const Vec<id_t>& args) const
+    {
+        return std::visit([&args](const auto& rel) { return rel.lookup(args); }, impl);
+    }
+
+    /**
+     * @brief Call f(children, nchildren, eclass) for each term of the relation
+     */
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        std::visit([&f](const auto& rel) { rel.for_each_term(f); }, impl);
+    }
+
     AbstractIndex populate_index(uint32_t veo)
     {
         return std::visit([veo](auto& rel) { return rel.populate_index(veo); }, impl);
@@ -60,6 +92,82 @@ class AbstractRelation
         return std::visit([handle](auto& rel) { return rel.rebuild(handle); }, impl);
     }
 
+    /**
+     * @brief One round of congruence detection which leaves unifying to the caller
+     *
+     * Only supported by RowStore and RelationC relations, see RowStore::collect_unions.
+     */
+    void collect_unions(const Handle handle, Vec<std::pair<id_t, id_t>>& unions)
+    {
+        assert(!is_flattened());
+        if (is_c())
+            std::get<RelationC>(impl).collect_unions(handle, unions);
+        else
+            std::get<RowStore>(impl).collect_unions(handle, unions);
+    }
+
+    void set_unit(id_t unit)
+    {
+        assert(is_ac());
+        std::get<RelationAC>(impl).set_unit(unit);
+    }
+
+    void set_lazy_flattening(bool enabled)
+    {
+        assert(is_ac());
+        std::get<RelationAC>(impl).set_lazy_flattening(enabled);
+    }
+
+    void mark_multisets(Vec<bool>& live)
+    {
+        assert(is_ac());
+        std::get<RelationAC>(impl).mark_multisets(live);
+    }
+
+    void set_limits(const ACLimits& limits)
+    {
+        assert(is_flattened());
+        if (is_a())
+            std::get<RelationA>(impl).set_limits(limits);
+        else
+            std::get<RelationAC>(impl).set_limits(limits);
+    }
+
+    const ACLimitCounters& limit_counters() const
+    {
+        assert(is_flattened());
+        if (is_a())
+            return std::get<RelationA>(impl).limit_counters();
+
+        return std::get<RelationAC>(impl).limit_counters();
+    }
+
+    size_t pending(const Handle handle) const
+    {
+        assert(!is_flattened());
+        if (is_c())
+            return std::get<RelationC>(impl).pending(handle);
+
+        return std::get<RowStore>(impl).pending(handle);
+    }
+
+    /**
+     * @brief Map a permutation to the key of the index which serves it
+     *
+     * AC and A relations have a single index keyed by -1, see
+     * RelationC::normalize_permutation for C relations.
+     */
+    uint32_t normalize_permutation(uint32_t perm) const
+    {
+        if (is_flattened())
+            return static_cast<uint32_t>(-1);
+
+        if (is_c())
+            return std::get<RelationC>(impl).normalize_permutation(perm);
+
+        return perm;
+    }
+
     void dump(std::ofstream& out, const SymbolTable& symbols) const
     {
         return std::visit([&out, &symbols](auto& rel) { rel.dump(out, symbols); }, impl);
@@ -69,6 +177,26 @@ class AbstractRelation
     {
         return std::holds_alternative<RelationAC>(impl);
     }
+
+    bool is_c() const
+    {
+        return std::holds_alternative<RelationC>(impl);
+    }
+
+    bool is_a() const
+    {
+        return std::holds_alternative<RelationA>(impl);
+    }
+
+    /**
+     * @brief Check for relations which flatten their terms while rebuilding
+     *
+     * Those mutate the e-graph during rebuild and have to be rebuilt serially.
+     */
+    bool is_flattened() const
+    {
+        return is_ac() || is_a();
+    }
 };
 
 } // namespace eqsat
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace eqsat
+{
+
+/**
+ * @brief Bounds on the tuples flattening and unflattening may derive
+ *
+ * Shared by the AC and the A relations. Derivations beyond a bound are
+ * dropped, which costs completeness but keeps the memory and the latency
+ * of a rebuild predictable. Unbounded by default.
+ */
+struct ACLimits
+{
+    // derived tuples per rebuild
+    size_t max_derived = SIZE_MAX;
+    // children of a derived tuple
+    size_t max_size = SIZE_MAX;
+    // flatten and unflatten steps between a derived tuple and the tuples added to the e-graph
+    uint32_t max_depth = UINT32_MAX;
+    // flattened tuples derived at once by lazy flattening, see RelationAC
+    size_t max_lazy = SIZE_MAX;
+};
+
+/**
+ * @brief How often each of the ACLimits triggered
+ */
+struct ACLimitCounters
+{
+    // rebuilds which stopped deriving tuples early
+    size_t derived = 0;
+    // derived tuples dropped for their size
+    size_t size = 0;
+    // derived tuples dropped for their depth
+    size_t depth = 0;
+    // lazy flattenings which stopped early
+    size_t lazy = 0;
+
+    ACLimitCounters& operator+=(const ACLimitCounters& other)
+    {
+        derived += other.derived;
+        size += other.size;
+        depth += other.depth;
+        lazy += other.lazy;
+        return *this;
+    }
+};
+
+} // namespace eqsat
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <tuple>
+#include <utility>
+
+#include "indices/abstract_index.h"
+#include "indices/sequence_index.h"
+#include "relation_a.h"
+
+namespace eqsat
+{
+
+namespace
+{
+
+// register pos under value, each position is appended once per list
+void post(HashMap<id_t, Vec<uint32_t>>& postings, id_t value, uint32_t pos)
+{
+    auto& list = postings[value];
+    if (list.empty() || list.back() != pos)
+        list.push_back(pos);
+}
+
+// replace the window [begin, begin + length) of sequence by the given elements
+template <typename It>
+Vec<id_t> splice(const Vec<id_t>& sequence, size_t begin, size_t length, It first, It last)
+{
+    Vec<id_t> result;
+    result.reserve(sequence.size() - length + (last - first));
+
+    result.insert(result.end(), sequence.begin(), sequence.begin() + begin);
+    result.insert(result.end(), first, last);
+    result.insert(result.end(), sequence.begin() + begin + length, sequence.end());
+
+    return result;
+}
+
+// the elements of sequence, each once
+Vec<id_t> distinct(const Vec<id_t>& sequence)
+{
+    Vec<id_t> values(sequence.begin(), sequence.end());
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    return values;
+}
+
+// sort positions and drop the repeated ones
+void deduplicate(Vec<uint32_t>& list)
+{
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+}
+
+} // namespace
+
+uint64_t RelationA::fingerprint(const Vec<id_t>& sequence)
+{
+    uint64_t h = hash64(sequence.size());
+    for (id_t value : sequence)
+        h = mix64(h, value);
+
+    return mix64(h, sequence.size());
+}
+
+void RelationA::link(uint32_t pos)
+{
+    positions[fingerprint(*sequences[pos])].push_back(pos);
+}
+
+void RelationA::unlink(uint32_t pos)
+{
+    auto it = positions.find(fingerprint(*sequences[pos]));
+    assert(it != positions.end());
+
+    auto& bucket = it->second;
+    bucket.erase(std::find(bucket.begin(), bucket.end(), pos));
+    if (bucket.empty())
+        positions.erase(it);
+}
+
+uint32_t RelationA::find_duplicate(uint32_t pos) const
+{
+    auto it = positions.find(fingerprint(*sequences[pos]));
+    assert(it != positions.end());
+
+    for (uint32_t other : it->second)
+        if (other != pos && *sequences[other] == *sequences[pos])
+            return other;
+
+    return NIL;
+}
+
+void RelationA::compact()
+{
+    // positions --> new positions, for the tuples whose derivations were deferred
+    Vec<uint32_t> renumbered(ids.size(), NIL);
+
+    size_t live = 0;
+    size_t live_seen = 0;
+    for (uint32_t pos = 0; pos < ids.size(); ++pos)
+    {
+        if (is_dead(pos))
+            continue;
+
+        if (pos < nseen)
+            ++live_seen;
+
+        renumbered[pos] = static_cast<uint32_t>(live);
+        ids[live] = ids[pos];
+        sequences[live] = std::move(sequences[pos]);
+        depths[live] = depths[pos];
+        ++live;
+    }
+
+    ids.resize(live);
+    sequences.resize(live);
+    depths.resize(live);
+    nseen = live_seen;
+    ndead = 0;
+
+    positions.clear();
+    occurrences.clear();
+    owners.clear();
+
+    for (uint32_t pos = 0; pos < ids.size(); ++pos)
+    {
+        link(pos);
+        for (id_t value : *sequences[pos])
+            post(occurrences, value, pos);
+
+        post(owners, ids[pos], pos);
+    }
+
+    Vec<uint32_t> pending;
+    for (uint32_t pos : deferred)
+        if (renumbered[pos] != NIL)
+            pending.push_back(renumbered[pos]);
+
+    deferred = std::move(pending);
+}
+
+bool RelationA::insert(id_t id, Vec<id_t> sequence, uint32_t depth)
+{
+    if (contains(id, sequence))
+        return false;
+
+    auto pos = static_cast<uint32_t>(ids.size());
+
+    for (id_t value : sequence)
+        post(occurrences, value, pos);
+
+    post(owners, id, pos);
+
+    ids.push_back(id);
+    sequences.push_back(std::make_shared<const Vec<id_t>>(std::move(sequence)));
+    depths.push_back(depth);
+    link(pos);
+    return true;
+}
+
+bool RelationA::admit(const Vec<id_t>& args, uint32_t depth)
+{
+    if (args.size() > limits.max_size)
+    {
+        ++counters.size;
+        return false;
+    }
+
+    if (depth > limits.max_depth)
+    {
+        ++counters.depth;
+        return false;
+    }
+
+    return true;
+}
+
+bool RelationA::exhausted()
+{
+    if (nderived < limits.max_derived)
+        return false;
+
+    if (!truncated)
+        ++counters.derived;
+
+    truncated = true;
+    return true;
+}
+
+bool RelationA::contains(id_t id, const Vec<id_t>& sequence) const
+{
+    auto it = positions.find(fingerprint(sequence));
+    if (it == positions.end())
+        return false;
+
+    for (uint32_t pos : it->second)
+        if (ids[pos] == id && *sequences[pos] == sequence)
+            return true;
+
+    return false;
+}
+
+std::optional<id_t> RelationA::lookup(const Vec<id_t>& args) const
+{
+    auto it = positions.find(fingerprint(args));
+    if (it == positions.end())
+        return std::nullopt;
+
+    for (uint32_t pos : it->second)
+        if (*sequences[pos] == args)
+            return ids[pos];
+
+    return std::nullopt;
+}
+
+void RelationA::add_tuple(const Vec<id_t>& tuple)
+{
+    id_t id = tuple.back();
+    Vec<id_t> sequence{tuple.cbegin(), tuple.cend() - 1};
+
+    insert(id, std::move(sequence), 0);
+}
+
+AbstractIndex RelationA::populate_index(uint32_t)
+{
+    return AbstractIndex(SequenceIndex(symbol, std::make_shared<const Vec<Sequence>>(sequences)));
+}
+
+bool RelationA::canonicalize(const Handle egraph, uint32_t pos)
+{
+    bool changed = false;
+
+    auto stale = [egraph](id_t value) { return egraph.canonicalize(value) != value; };
+    if (std::any_of(sequences[pos]->begin(), sequences[pos]->end(), stale))
+    {
+        // the hash index is keyed by the sequence
+        unlink(pos);
+
+        // indices may still share the old sequence
+        auto sequence = *sequences[pos];
+        for (auto& value : sequence)
+        {
+            id_t canonical = egraph.canonicalize(value);
+            if (canonical == value)
+                continue;
+
+            // later merges of the new id have to find this tuple again
+            value = canonical;
+            post(occurrences, value, pos);
+        }
+
+        sequences[pos] = std::make_shared<const Vec<id_t>>(std::move(sequence));
+        link(pos);
+        changed = true;
+    }
+
+    id_t id = egraph.canonicalize(ids[pos]);
+    if (id != ids[pos])
+    {
+        ids[pos] = id;
+        post(owners, id, pos);
+        changed = true;
+    }
+
+    return changed;
+}
+
+void RelationA::congruence(Handle egraph, const Vec<uint32_t>& dirty, Vec<id_t>& merged)
+{
+    for (uint32_t pos : dirty)
+    {
+        // no two live tuples of the previous rebuild had equal sequences,
+        // so every collision involves a dirty tuple
+        while (!is_dead(pos))
+        {
+            uint32_t other = find_duplicate(pos);
+            if (other == NIL)
+                break;
+
+            // unions of this very loop may have re-rooted the e-classes already
+            id_t id1 = egraph.canonicalize(ids[pos]);
+            id_t id2 = egraph.canonicalize(ids[other]);
+            if (id1 != id2)
+            {
+                id_t root = egraph.unify(id1, id2);
+                merged.push_back(root == id1 ? id2 : id1);
+            }
+
+            // the older tuple stays, its id is repaired through merged if need be
+            uint32_t keep = std::min(pos, other);
+            uint32_t drop = std::max(pos, other);
+
+            depths[keep] = std::min(depths[keep], depths[drop]);
+            kill(drop);
+        }
+    }
+}
+
+bool RelationA::add_derived(Worklist& worklist)
+{
+    bool changed = false;
+
+    for (auto& [id, sequence, depth] : worklist)
+        changed |= insert(id, std::move(sequence), depth);
+
+    return changed;
+}
+
+void RelationA::derive(Worklist& worklist, uint32_t pos_a, uint32_t pos_b, Vec<id_t> args)
+{
+    if (contains(ids[pos_a], args) || exhausted())
+        return;
+
+    uint32_t depth = std::max(depths[pos_a], depths[pos_b]) + 1;
+    if (!admit(args, depth))
+        return;
+
+    worklist.push_back({ids[pos_a], std::move(args), depth});
+    ++nderived;
+}
+
+void RelationA::flatten(Worklist& worklist, uint32_t pos_a, uint32_t pos_b)
+{
+    id_t id_b = ids[pos_b];
+    const auto& seq_a = *sequences[pos_a];
+    const auto& seq_b = *sequences[pos_b];
+
+    if (std::find(seq_b.begin(), seq_b.end(), id_b) != seq_b.end()) // cyclic
+        return;
+
+    // a = f(X b Y)
+    // b = f(Z)
+    // ~~> a = f(X Z Y)
+    for (size_t i = 0; i < seq_a.size(); ++i)
+        if (seq_a[i] == id_b)
+            derive(worklist, pos_a, pos_b, splice(seq_a, i, 1, seq_b.begin(), seq_b.end()));
+}
+
+void RelationA::unflatten(Worklist& worklist, uint32_t pos_a, uint32_t pos_b)
+{
+    id_t id_b = ids[pos_b];
+    const auto& seq_a = *sequences[pos_a];
+    const auto& seq_b = *sequences[pos_b];
+
+    // The empty sequence occurs everywhere, but unflattening it would
+    // only grow the terms. Equal lengths would mean equal sequences.
+    if (seq_b.empty() || seq_a.size() <= seq_b.size())
+        return;
+
+    // a = f(X Z Y)
+    // b = f(Z)
+    // ~~> a = f(X b Y)
+    auto it = seq_a.begin();
+    while ((it = std::search(it, seq_a.end(), seq_b.begin(), seq_b.end())) != seq_a.end())
+    {
+        size_t begin = it - seq_a.begin();
+        derive(worklist, pos_a, pos_b, splice(seq_a, begin, seq_b.size(), &id_b, &id_b + 1));
+        ++it;
+    }
+}
+
+bool RelationA::flatten(const Vec<uint32_t>& touched)
+{
+    Worklist worklist;
+
+    for (size_t i = 0; i < touched.size() && !exhausted(); ++i)
+    {
+        uint32_t pos = touched[i];
+        if (is_dead(pos))
+            continue;
+
+        // as b, into the tuples whose sequence contains its e-class
+        auto it = occurrences.find(ids[pos]);
+        if (it != occurrences.end())
+            for (uint32_t pos_a : it->second)
+                if (!is_dead(pos_a))
+                    flatten(worklist, pos_a, pos);
+
+        // as a, the tuples of the e-classes in its sequence into it
+        for (id_t value : distinct(*sequences[pos]))
+        {
+            auto jt = owners.find(value);
+            if (jt == owners.end())
+                continue;
+
+            for (uint32_t pos_b : jt->second)
+                if (!is_dead(pos_b) && ids[pos_b] == value)
+                    flatten(worklist, pos, pos_b);
+        }
+    }
+
+    // inserting may grow the posting lists iterated above,
+    // so the derived tuples are only added now
+    return add_derived(worklist);
+}
+
+bool RelationA::unflatten(const Vec<uint32_t>& touched)
+{
+    Worklist worklist;
+
+    for (size_t i = 0; i < touched.size() && !exhausted(); ++i)
+    {
+        uint32_t pos = touched[i];
+        if (is_dead(pos))
+            continue;
+
+        // as b, every tuple containing its sequence is in the posting list of each of its elements
+        const Vec<uint32_t> *candidates = nullptr;
+        for (id_t value : *sequences[pos])
+        {
+            auto it = occurrences.find(value);
+            if (it == occurrences.end())
+            {
+                candidates = nullptr;
+                break;
+            }
+
+            if (candidates == nullptr || it->second.size() < candidates->size())
+                candidates = &it->second;
+        }
+
+        if (candidates != nullptr)
+            for (uint32_t pos_a : *candidates)
+                if (!is_dead(pos_a))
+                    unflatten(worklist, pos_a, pos);
+
+        // as a, every window of its sequence starts with one of its elements
+        for (id_t value : distinct(*sequences[pos]))
+        {
+            auto it = occurrences.find(value);
+            if (it == occurrences.end())
+                continue;
+
+            for (uint32_t pos_b : it->second)
+                if (!is_dead(pos_b) && !sequences[pos_b]->empty() && sequences[pos_b]->front() == value)
+                    unflatten(worklist, pos, pos_b);
+        }
+    }
+
+    return add_derived(worklist);
+}
+
+bool RelationA::rebuild(Handle egraph)
+{
+    bool changed = false;
+
+    if (ndead > 0 && 2 * ndead >= ids.size())
+        compact();
+
+    Vec<uint32_t> dirty;
+    auto mark = [&](id_t id) {
+        for (auto *postings : {&occurrences, &owners})
+        {
+            auto it = postings->find(id);
+            if (it != postings->end())
+                dirty.insert(dirty.end(), it->second.begin(), it->second.end());
+        }
+    };
+
+    // At first the tuples added since the last rebuild are dirty, and the ones
+    // mentioning an id which was re-rooted since. Afterwards only the tuples
+    // which mention an id that got merged away by the previous round are.
+    dirty.resize(ids.size() - nseen);
+    std::iota(dirty.begin(), dirty.end(), static_cast<uint32_t>(nseen));
+
+    egraph.sync_union_log();
+    const auto& log = egraph.union_log();
+    for (; log_cursor < log.size(); ++log_cursor)
+        mark(log[log_cursor]);
+
+    deduplicate(dirty);
+
+    // the new tuples and the changed ones take part in flattening and unflattening
+    Vec<uint32_t> touched = std::move(deferred);
+    deferred.clear();
+    for (size_t pos = nseen; pos < ids.size(); ++pos)
+        touched.push_back(static_cast<uint32_t>(pos));
+
+    Vec<id_t> merged;
+    while (!dirty.empty())
+    {
+        for (uint32_t pos : dirty)
+        {
+            if (!is_dead(pos) && canonicalize(egraph, pos))
+            {
+                touched.push_back(pos);
+                changed = true;
+            }
+        }
+
+        congruence(egraph, dirty, merged);
+
+        dirty.clear();
+        for (id_t id : merged)
+            mark(id);
+
+        merged.clear();
+        deduplicate(dirty);
+    }
+
+    // the unions of this rebuild were handled through merged
+    egraph.sync_union_log();
+    log_cursor = egraph.union_log().size();
+    nseen = ids.size();
+
+    nderived = 0;
+    truncated = false;
+
+    deduplicate(touched);
+    changed |= flatten(touched);
+    changed |= unflatten(touched);
+
+    // the pairs skipped for the derived tuple limit are tried again next time
+    if (truncated)
+        deferred = std::move(touched);
+
+    // the derived tuples stay dirty for the next rebuild, see RelationAC
+    dirty.resize(ids.size() - nseen);
+    std::iota(dirty.begin(), dirty.end(), static_cast<uint32_t>(nseen));
+    congruence(egraph, dirty, merged);
+
+    return changed;
+}
+
+void RelationA::dump(std::ofstream& out, const SymbolTable& symbols) const
+{
+    out << "---- " << symbols.get_string(symbol) << "(A) with " << size() << " tuples ----" << std::endl;
+
+    for (uint32_t pos = 0; pos < ids.size(); ++pos)
+    {
+        if (is_dead(pos))
+            continue;
+
+        out << "eclass-id: " << ids[pos] << "  seq: [";
+
+        const auto& sequence = *sequences[pos];
+        for (size_t i = 0; i < sequence.size(); ++i)
+        {
+            if (i > 0)
+                out << ", ";
+            out << sequence[i];
+        }
+
+        out << "]" << std::endl;
+    }
+    out << std::endl;
+}
+
+} // namespace eqsat
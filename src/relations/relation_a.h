@@ -0,0 +1,255 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "handle.h"
+#include "indices/abstract_index.h"
+#include "indices/sequence_index.h"
+#include "relations/ac_limits.h"
+#include "symbol_table.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Relation storing tuples `op([args...]; eclass_id)` of an associative operator
+ *
+ * The counterpart of RelationAC for operators which are associative but not
+ * commutative, like composition or concatenation. Arguments are stored as
+ * flattened sequences whose order matters. The position of a tuple doubles as
+ * its term-id during matching, and a hash index keyed by the sequence
+ * deduplicates tuples and serves as the hash-cons of the relation.
+ *
+ * Rebuilding first closes the relation under congruence, then
+ *
+ * - **flattens**: `a = f(X b Y)` and `b = f(Z)` give `a = f(X Z Y)`
+ * - **unflattens**: `a = f(X Z Y)` and `b = f(Z)` give `a = f(X b Y)`, for
+ *   every contiguous occurrence of Z in the sequence of a
+ *
+ * so every parenthesization of a term is represented by its contiguous windows,
+ * without rules enumerating them. Patterns match contiguous windows of the
+ * sequences, see SequenceIndex.
+ *
+ * Like RelationAC, congruence closure only visits the tuples added since the
+ * last rebuild and the parents of e-classes merged since, found through the
+ * element and e-class postings. Canonicalized tuples are moved to their new
+ * key in the hash index, and of two tuples with equal sequences the younger
+ * one is dropped right away. Dropped tuples leave a tombstone behind until
+ * they make up half of the relation, then the positions are compacted.
+ *
+ * Flattening and unflattening are semi-naive. Only pairs of tuples of which
+ * at least one is new or changed since the last rebuild can derive anything
+ * new, so a rebuild joins just those tuples against the postings of their
+ * e-class and of their elements.
+ *
+ * Every sequence is shared with the indices and never changed in place.
+ * Canonicalizing a tuple replaces its sequence, so an index which is still
+ * alive keeps seeing the relation as of its creation, at the cost of a copy
+ * of the changed sequences only.
+ *
+ * Like RelationAC, flattening and unflattening respect the ACLimits of the
+ * relation, and every tuple remembers its depth.
+ */
+class RelationA
+{
+  private:
+    // marks a dropped tuple in its e-class id
+    static constexpr id_t TOMBSTONE = ~static_cast<id_t>(0);
+    // no position
+    static constexpr uint32_t NIL = ~static_cast<uint32_t>(0);
+
+    // derived tuples (e-class id, sequence, depth) waiting to be inserted
+    using Worklist = Vec<std::tuple<id_t, Vec<id_t>, uint32_t>>;
+
+    Symbol symbol;
+    // position --> e-class id
+    Vec<id_t> ids;
+    // position --> argument sequence, shared with the indices, nullptr for dropped tuples
+    Vec<Sequence> sequences;
+    // position --> number of derivation steps behind the tuple
+    Vec<uint32_t> depths;
+
+    // fingerprint of the sequence --> live positions with that fingerprint
+    HashMap<uint64_t, Vec<uint32_t>> positions;
+    // element id --> positions of the tuples whose sequence contains it, may be stale
+    HashMap<id_t, Vec<uint32_t>> occurrences;
+    // e-class id --> positions of the tuples in that e-class, may be stale
+    HashMap<id_t, Vec<uint32_t>> owners;
+
+    // how much of the union-find log has already been processed
+    size_t log_cursor = 0;
+    // positions below this have been canonicalized
+    size_t nseen = 0;
+    size_t ndead = 0;
+    // new or changed positions whose derivations a truncated rebuild did not finish
+    Vec<uint32_t> deferred;
+
+    ACLimits limits;
+    ACLimitCounters counters;
+    // tuples derived by the current rebuild, and whether it ran out of them
+    size_t nderived = 0;
+    bool truncated = false;
+
+    static uint64_t fingerprint(const Vec<id_t>& sequence);
+
+    bool is_dead(uint32_t pos) const
+    {
+        return ids[pos] == TOMBSTONE;
+    }
+
+    /**
+     * @brief Add a live position to the key of its sequence in the hash index
+     */
+    void link(uint32_t pos);
+
+    /**
+     * @brief Remove a position from the hash index, its sequence must not have changed since link
+     */
+    void unlink(uint32_t pos);
+
+    void kill(uint32_t pos)
+    {
+        unlink(pos);
+        ids[pos] = TOMBSTONE;
+        sequences[pos].reset();
+        ++ndead;
+    }
+
+    /**
+     * @brief Find another live position with an equal sequence in the hash index
+     *
+     * @return The other position, or NIL if there is none
+     */
+    uint32_t find_duplicate(uint32_t pos) const;
+
+    /**
+     * @brief Renumber the live positions without gaps and rebuild the postings
+     *
+     * Only called once dropped tuples make up at least half of the positions,
+     * which keeps the cost amortized constant per dropped tuple.
+     */
+    void compact();
+
+    bool insert(id_t id, Vec<id_t> sequence, uint32_t depth);
+
+    /**
+     * @brief Check a derived tuple against the size and depth limits, counting rejections
+     */
+    bool admit(const Vec<id_t>& args, uint32_t depth);
+
+    /**
+     * @brief Check whether the current rebuild derived as many tuples as allowed
+     */
+    bool exhausted();
+    bool contains(id_t id, const Vec<id_t>& sequence) const;
+    /**
+     * @brief Canonicalize the tuple at pos in place
+     *
+     * Registers the tuple under the new ids in the postings and moves it to
+     * the key of its new sequence in the hash index. The new sequence is a
+     * copy, indices keep the old one.
+     *
+     * @return true if the tuple changed
+     */
+    bool canonicalize(const Handle egraph, uint32_t pos);
+
+    /**
+     * @brief Unify the e-classes of the given tuples with the ones of tuples with equal sequences
+     *
+     * Of two tuples with equal sequences the younger one is dropped afterwards.
+     *
+     * @param merged Receives the ids which stopped being canonical
+     */
+    void congruence(Handle egraph, const Vec<uint32_t>& dirty, Vec<id_t>& merged);
+
+    /**
+     * @brief Add the derived tuples which are not in the relation yet
+     */
+    bool add_derived(Worklist& worklist);
+
+    /**
+     * @brief Queue the tuple `op(args; eclass of a)` derived from the tuples a and b, within the limits
+     */
+    void derive(Worklist& worklist, uint32_t pos_a, uint32_t pos_b, Vec<id_t> args);
+
+    /**
+     * @brief Flatten b into every occurrence of its e-class in the sequence of a
+     */
+    void flatten(Worklist& worklist, uint32_t pos_a, uint32_t pos_b);
+
+    /**
+     * @brief Replace every occurrence of the sequence of b in the sequence of a by the e-class of b
+     */
+    void unflatten(Worklist& worklist, uint32_t pos_a, uint32_t pos_b);
+
+    /**
+     * @brief Flatten the pairs of tuples involving one of the touched ones
+     */
+    bool flatten(const Vec<uint32_t>& touched);
+
+    /**
+     * @brief Unflatten the pairs of tuples involving one of the touched ones
+     */
+    bool unflatten(const Vec<uint32_t>& touched);
+
+  public:
+    explicit RelationA(Symbol symbol)
+        : symbol(symbol)
+        , ids()
+        , sequences()
+    {
+    }
+
+    Symbol get_symbol() const
+    {
+        return symbol;
+    }
+
+    size_t size() const
+    {
+        return ids.size() - ndead;
+    }
+
+    /**
+     * @brief Add a tuple `(args..., eclass_id)`, the arguments keep their order
+     */
+    void add_tuple(const Vec<id_t>& tuple);
+
+    /**
+     * @brief Find the e-class of the term with the given argument sequence
+     */
+    std::optional<id_t> lookup(const Vec<id_t>& args) const;
+
+    /**
+     * @brief Call f(children, nchildren, eclass) for each tuple, children in order
+     */
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        for (uint32_t pos = 0; pos < ids.size(); ++pos)
+            if (!is_dead(pos))
+                f(sequences[pos]->data(), sequences[pos]->size(), ids[pos]);
+    }
+
+    void set_limits(const ACLimits& new_limits)
+    {
+        limits = new_limits;
+    }
+
+    const ACLimitCounters& limit_counters() const
+    {
+        return counters;
+    }
+
+    AbstractIndex populate_index(uint32_t);
+
+    bool rebuild(Handle egraph);
+
+    void dump(std::ofstream& out, const SymbolTable& symbols) const;
+};
+
+} // namespace eqsat
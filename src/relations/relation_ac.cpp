@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <numeric>
+#include <tuple>
 #include <utility>
 
 #include "indices/abstract_index.h"
@@ -9,55 +11,173 @@
 namespace eqsat
 {
 
-bool RelationAC::insert(std::pair<id_t, Multiset> tuple)
+bool RelationAC::insert(id_t id, mset_id_t mset, uint32_t depth)
 {
-    auto cmp = [](const std::pair<id_t, Multiset>& lhs, const std::pair<id_t, Multiset>& rhs) {
-        if (lhs.first != rhs.first)
-            return lhs.first < rhs.first;
-        return lhs.second.hash() < rhs.second.hash();
-    };
+    auto pos = static_cast<uint32_t>(data.size());
+
+    if (!positions.try_emplace(key(id, mset), pos).second)
+        return false;
+
+    const Multiset& args = store->get(mset);
+    for (const auto& [value, count] : args.data)
+        if (count > 0)
+            occurrences[value].push_back(pos);
 
-    auto it = std::lower_bound(data.begin(), data.end(), tuple, cmp);
+    owners[id].push_back(pos);
+    classes.try_emplace(mset, id);
+    signatures.push_back(signature(args));
+    depths.push_back(depth);
+
+    data.push_back({id, mset});
+    return true;
+}
 
-    // TODO:
-    // Note that this is a silent bug waiting to happen...
-    // we assume that the hash is enough to differentiate multisets
-    // and don't perform any collision detection!
-    if (it != data.end() && it->first == tuple.first && it->second.hash() == tuple.second.hash())
+bool RelationAC::admit(const Multiset& args, uint32_t depth)
+{
+    if (args.size() > limits.max_size)
+    {
+        ++counters.size;
+        return false;
+    }
+
+    if (depth > limits.max_depth)
     {
+        ++counters.depth;
         return false;
     }
 
-    data.insert(it, std::move(tuple));
     return true;
 }
 
-bool RelationAC::contains(std::pair<id_t, Multiset> tuple)
+bool RelationAC::exhausted()
 {
-    auto cmp = [](const std::pair<id_t, Multiset>& lhs, const std::pair<id_t, Multiset>& rhs) {
-        if (lhs.first != rhs.first)
-            return lhs.first < rhs.first;
-        return lhs.second.hash() < rhs.second.hash();
+    if (nderived < limits.max_derived)
+        return false;
+
+    if (!truncated)
+        ++counters.derived;
+
+    truncated = true;
+    return true;
+}
+
+bool RelationAC::contains(id_t id, const Multiset& mset) const
+{
+    // a multiset which was never interned cannot be part of any tuple
+    mset_id_t mset_id = store->find(mset);
+    return mset_id != MultisetStore::NONE && positions.contains(key(id, mset_id));
+}
+
+const Vec<uint32_t> *RelationAC::candidates(const Multiset& mset) const
+{
+    const Vec<uint32_t> *best = nullptr;
+
+    for (const auto& [value, count] : mset.data)
+    {
+        if (count == 0)
+            continue;
+
+        auto it = occurrences.find(value);
+        if (it == occurrences.end())
+            return nullptr;
+
+        if (best == nullptr || it->second.size() < best->size())
+            best = &it->second;
+    }
+
+    return best;
+}
+
+void RelationAC::compact()
+{
+    // old position --> new position, NIL for dead ones
+    Vec<uint32_t> renumbered(data.size(), NIL);
+
+    size_t live = 0;
+    size_t live_seen = 0;
+    for (uint32_t pos = 0; pos < data.size(); ++pos)
+    {
+        if (is_dead(pos))
+            continue;
+
+        if (pos < nseen)
+            ++live_seen;
+
+        renumbered[pos] = static_cast<uint32_t>(live);
+        data[live] = data[pos];
+        signatures[live] = signatures[pos];
+        depths[live] = depths[pos];
+        ++live;
+    }
+
+    data.resize(live);
+    signatures.resize(live);
+    depths.resize(live);
+    nseen = live_seen;
+    ndead = 0;
+
+    positions.clear();
+    occurrences.clear();
+    owners.clear();
+
+    for (uint32_t pos = 0; pos < data.size(); ++pos)
+    {
+        const auto& [id, mset] = data[pos];
+        positions.emplace(key(id, mset), pos);
+
+        for (const auto& [value, count] : store->get(mset).data)
+            if (count > 0)
+                occurrences[value].push_back(pos);
+
+        owners[id].push_back(pos);
+    }
+
+    // renumbering keeps the relative order, so the sorted prefix stays sorted
+    auto renumber = [&renumbered](Vec<uint32_t>& list) {
+        Vec<uint32_t> result;
+        for (uint32_t pos : list)
+            if (renumbered[pos] != NIL)
+                result.push_back(renumbered[pos]);
+
+        list = std::move(result);
     };
 
-    auto it = std::lower_bound(data.begin(), data.end(), tuple, cmp);
+    renumber(order);
+    renumber(deferred);
+    index_buckets();
+}
+
+void RelationAC::mark_multisets(Vec<bool>& live)
+{
+    // dead tuples included, see order
+    for (const auto& [id, mset] : data)
+        live[mset] = true;
 
-    return it != data.end() && it->first == tuple.first && it->second.hash() == tuple.second.hash();
+    Vec<mset_id_t> stale;
+    for (const auto& [mset, id] : classes)
+        if (!live[mset])
+            stale.push_back(mset);
+
+    for (mset_id_t mset : stale)
+        classes.erase(mset);
 }
 
-void RelationAC::sort()
+std::optional<id_t> RelationAC::lookup(const Vec<id_t>& args) const
 {
-    std::sort(data.begin(), data.end(), [](const auto& lhs, const auto& rhs) {
-        if (lhs.first != rhs.first)
-            return lhs.first < rhs.first;
+    Multiset mset{args.cbegin(), args.cend()};
+    if (idempotent)
+        mset.dedup();
+
+    auto it = classes.find(store->find(mset));
+    if (it == classes.end())
+        return std::nullopt;
 
-        return lhs.second.hash() < rhs.second.hash();
-    });
+    return it->second;
 }
 
 void RelationAC::add_tuple(id_t id, Multiset mset)
 {
-    insert({id, mset});
+    insert(id, intern(std::move(mset)));
 }
 
 void RelationAC::add_tuple(const Vec<id_t>& tuple)
@@ -65,235 +185,600 @@ void RelationAC::add_tuple(const Vec<id_t>& tuple)
     id_t id = tuple.back();
     Multiset mset{tuple.cbegin(), tuple.cend() - 1};
 
-    insert({id, mset});
+    insert(id, intern(std::move(mset)));
 }
 
-AbstractIndex RelationAC::populate_index(uint32_t)
+void RelationAC::sort_by_size()
 {
-    HashMap<id_t, Multiset> index;
+    size_t nsorted = order.size();
+    if (nsorted == data.size())
+        return;
 
-    size_t n = data.size();
-    for (size_t i = 0; i < n; ++i)
-    {
-        index.insert({/* term-id: */ i, data[i].second});
-    }
+    auto less = [this](uint32_t lhs, uint32_t rhs) {
+        return store->get(data[lhs].second) < store->get(data[rhs].second);
+    };
+
+    order.resize(data.size());
+    std::iota(order.begin() + nsorted, order.end(), static_cast<uint32_t>(nsorted));
 
-    return AbstractIndex(MultisetIndex(symbol, index));
+    std::sort(order.begin() + nsorted, order.end(), less);
+    std::inplace_merge(order.begin(), order.begin() + nsorted, order.end(), less);
+
+    index_buckets();
 }
 
-void RelationAC::deduplicate()
+void RelationAC::index_buckets()
 {
-    if (data.empty())
+    buckets.clear();
+    if (order.empty())
         return;
 
-    size_t write_idx = 0;
-    for (size_t read_idx = 1; read_idx < data.size(); ++read_idx)
+    auto size_of = [this](uint32_t pos) { return store->get(data[pos].second).size(); };
+    size_t largest = size_of(order.back());
+
+    for (size_t size = 0; size <= largest; ++size)
+    {
+        auto it = std::partition_point(order.begin(), order.end(),
+                                       [&](uint32_t pos) { return size_of(pos) < size; });
+        buckets.push_back(static_cast<uint32_t>(it - order.begin()));
+    }
+}
+
+Vec<std::pair<id_t, mset_id_t>> RelationAC::flattened_tuples(MultisetStore& local)
+{
+    Vec<std::pair<id_t, mset_id_t>> derived;
+    Vec<uint32_t> derived_depths;
+    // derived tuple --> e-classes flattened into it, in no particular order
+    Vec<Vec<id_t>> paths;
+    HashSet<uint64_t> seen;
+
+    // derived tuples are flattened further, up to the limit
+    for (size_t i = 0; i < data.size() + derived.size(); ++i)
     {
-        if (data[write_idx].first != data[read_idx].first ||
-            data[write_idx].second.hash() != data[read_idx].second.hash())
+        bool stored = i < data.size();
+        if (stored && is_dead(static_cast<uint32_t>(i)))
+            continue;
+
+        auto [id_a, mset_id_a] = stored ? data[i] : derived[i - data.size()];
+        uint32_t depth_a = stored ? depths[i] : derived_depths[i - data.size()];
+
+        // interning below may move the derived multisets
+        Multiset mset_a = stored ? store->get(mset_id_a) : local.get(mset_id_a);
+        Vec<id_t> path_a = stored ? Vec<id_t>() : paths[i - data.size()];
+
+        for (const auto& [id_b, count] : mset_a.data)
         {
-            ++write_idx;
-            if (write_idx != read_idx)
+            auto it = owners.find(id_b);
+            if (count == 0 || it == owners.end())
+                continue;
+
+            // Flattening an e-class into a tuple derived by flattening it
+            // already only happens on a cycle, and would never end there.
+            if (std::find(path_a.begin(), path_a.end(), id_b) != path_a.end())
+                continue;
+
+            for (uint32_t pos_b : it->second)
             {
-                data[write_idx] = std::move(data[read_idx]);
+                if (data[pos_b].first != id_b)
+                    continue;
+
+                const Multiset& mset_b = store->get(data[pos_b].second);
+                if (mset_b.contains(id_b)) // cyclic
+                    continue;
+
+                // a = f(X \cup {b})
+                // b = f(Y)
+                // ~~> a = f(X \cup Y)
+                Multiset args = mset_a;
+                args.remove(id_b);
+                args.insert_all(mset_b);
+
+                uint32_t depth = std::max(depth_a, depths[pos_b]) + 1;
+                if (!admit(args, depth))
+                    continue;
+
+                mset_id_t stored_mset = store->find(args);
+                if (stored_mset != MultisetStore::NONE && positions.contains(key(id_a, stored_mset)))
+                    continue;
+
+                mset_id_t mset = local.intern(std::move(args));
+                if (!seen.insert(key(id_a, mset)).second)
+                    continue;
+
+                if (derived.size() >= limits.max_lazy)
+                {
+                    ++counters.lazy;
+                    return derived;
+                }
+
+                derived.push_back({id_a, mset});
+                derived_depths.push_back(depth);
+                paths.push_back(path_a);
+                paths.back().push_back(id_b);
             }
         }
     }
 
-    data.resize(write_idx + 1);
+    return derived;
 }
 
-// O(mn)
-bool RelationAC::canonicalize(const Handle egraph)
+AbstractIndex RelationAC::populate_index(uint32_t)
 {
-    bool changed = false;
+    sort_by_size();
+
+    // (e-class id, multiset id, whether the multiset is in the local store)
+    Vec<std::tuple<id_t, mset_id_t, bool>> tuples;
+    tuples.reserve(order.size());
+    for (uint32_t pos : order)
+        if (!is_dead(pos))
+            tuples.push_back({data[pos].first, data[pos].second, false});
+
+    auto local = std::make_shared<MultisetStore>();
+    auto children = [&](const auto& tuple) -> const Multiset& {
+        const auto& [_, mset_id, derived] = tuple;
+        return derived ? local->get(mset_id) : store->get(mset_id);
+    };
 
-    for (auto& [id, mset] : data)
+    if (lazy)
     {
-        changed |= mset.map([egraph](id_t x) { return egraph.canonicalize(x); });
+        // the flattened tuples only exist in the index, and so do their multisets
+        auto less = [&](const auto& lhs, const auto& rhs) { return children(lhs) < children(rhs); };
 
-        id_t newid = egraph.canonicalize(id);
-        if (id != newid)
-        {
-            changed = true;
-            id = newid;
-        }
+        size_t nreal = tuples.size();
+        for (const auto& [id, mset_id] : flattened_tuples(*local))
+            tuples.push_back({id, mset_id, true});
+
+        std::sort(tuples.begin() + nreal, tuples.end(), less);
+        std::inplace_merge(tuples.begin(), tuples.begin() + nreal, tuples.end(), less);
     }
 
-    // we mutated the tuples inplace so they are no longer ordered.
-    // For future insertions/lookups they should be sorted.
-    if (changed)
+    auto terms = std::make_shared<HashMap<id_t, mset_id_t>>();
+    auto derived_terms = std::make_shared<HashMap<id_t, mset_id_t>>();
+    auto layout = std::make_shared<TermOrder>();
+
+    // term-ids follow the size order, so the terms with at
+    // least k children are a suffix of the term-ids
+    size_t n = tuples.size();
+    for (size_t i = 0; i < n; ++i)
     {
-        sort();
-        deduplicate();
+        const auto& [id, mset_id, derived] = tuples[i];
+        const Multiset& mset = children(tuples[i]);
+
+        (derived ? derived_terms : terms)->insert({/* term-id: */ i, mset_id});
+
+        layout->ids.push_back(i);
+        layout->eclasses.push_back(id);
+        layout->owners[id].push_back(i);
+
+        while (layout->sizes.size() <= mset.size())
+            layout->sizes.push_back(i);
+
+        for (const auto& [value, count] : mset.data)
+            if (count > 0)
+                layout->occurrences[value].push_back(i);
     }
 
-    return changed;
+    MultisetIndex index(symbol, store, std::move(terms), unit, std::move(layout));
+    if (!derived_terms->empty())
+        index.set_derived_terms(std::move(local), std::move(derived_terms));
+
+    return AbstractIndex(std::move(index));
 }
 
-namespace
+uint32_t RelationAC::canonicalize(const Handle egraph, uint32_t pos)
 {
-using MultisetPtr = const Multiset *;
+    auto [id, mset_id] = data[pos];
 
-struct MultisetPtrHash
-{
-    size_t operator()(MultisetPtr ptr) const
+    const Multiset& mset = store->get(mset_id);
+
+    bool stale = false;
+    for (const auto& [value, count] : mset.data)
+        stale |= count > 0 && (egraph.canonicalize(value) != value || value == unit);
+
+    id_t newid = egraph.canonicalize(id);
+    if (!stale && newid == id)
+        return pos;
+
+    Multiset canonical = mset;
+    if (stale)
     {
-        return ptr->hash();
+        canonical.map([egraph](id_t x) { return egraph.canonicalize(x); });
+
+        if (unit.has_value())
+            canonical.erase(*unit);
     }
-};
 
-struct MultisetPtrEqual
+    // the canonical tuple gets a position of its own, so the
+    // postings and the sort order of all others stay valid
+    kill(pos);
+
+    // merged children of an ACI tuple repeat
+    if (!insert(newid, intern(std::move(canonical)), depths[pos]))
+        return NIL;
+
+    return static_cast<uint32_t>(data.size() - 1);
+}
+
+// assumes the dirty tuples are canonical!
+void RelationAC::congruence(Handle egraph, const Vec<uint32_t>& dirty, Vec<id_t>& merged)
 {
-    bool operator()(MultisetPtr a, MultisetPtr b) const
+    for (uint32_t pos : dirty)
     {
-        return *a == *b;
-    }
-};
-} // namespace
+        if (is_dead(pos))
+            continue;
 
-// O(mn)
-// assumes canonical relation!
-bool RelationAC::congruence(Handle egraph)
-{
-    HashMap<MultisetPtr, id_t, MultisetPtrHash, MultisetPtrEqual> cache;
+        // unions of this very loop may have re-rooted the e-class already
+        id_t id = egraph.canonicalize(data[pos].first);
+        mset_id_t mset = data[pos].second;
 
-    bool changed = false;
-    for (const auto& [id, mset] : data)
-    {
-        auto iter = cache.find(&mset);
-        if (iter != cache.end()) // found!
+        // op() is the unit and op(x) is x
+        if (collapses(store->get(mset)))
         {
-            id_t other_id = iter->second;
-            if (egraph.equiv(id, other_id))
-                continue;
+            auto args = store->get(mset).collect();
+            id_t other_id = args.empty() ? egraph.canonicalize(*unit) : args.front();
+
+            if (other_id != id)
+            {
+                id_t root = egraph.unify(id, other_id);
+                merged.push_back(root == id ? other_id : id);
+            }
 
-            iter->second = egraph.unify(id, other_id);
-            changed = true;
+            // the tuple only stands for its child
+            kill(pos);
+            continue;
         }
-        else
+
+        // interned multisets are equal iff their ids are
+        auto [iter, inserted] = classes.try_emplace(mset, id);
+        if (inserted)
+            continue;
+
+        id_t other_id = egraph.canonicalize(iter->second);
+        if (other_id == id)
         {
-            cache.emplace(&mset, id);
+            iter->second = id;
+            continue;
         }
+
+        id_t root = egraph.unify(id, other_id);
+        merged.push_back(root == id ? other_id : id);
+        iter->second = root;
     }
+}
+
+void RelationAC::flatten_into(Worklist& worklist, uint32_t pos_a, uint32_t pos_b)
+{
+    const auto& [id_a, mset_id_a] = data[pos_a];
+    const auto& [id_b, mset_id_b] = data[pos_b];
+
+    if (mset_id_a == mset_id_b)
+        return;
 
-    return changed;
+    const Multiset& mset_b = store->get(mset_id_b);
+    if (mset_b.contains(id_b)) // cyclic
+        return;
+
+    // a = f(X \cup {b})
+    // b = f(Y)
+    // ~~> a = f(X \cup Y)
+    auto args = store->get(mset_id_a);
+    args.remove(id_b);
+    args.insert_all(mset_b);
+
+    if (idempotent)
+        args.dedup();
+
+    if (contains(id_a, args) || exhausted())
+        return;
+
+    uint32_t depth = std::max(depths[pos_a], depths[pos_b]) + 1;
+    if (!admit(args, depth))
+        return;
+
+    worklist.push_back({id_a, std::move(args), depth});
+    ++nderived;
+}
+
+void RelationAC::add_derived(Worklist& worklist)
+{
+    // interning may move the stored multisets,
+    // so the derived tuples are only added now
+    for (auto& [id, mset, depth] : worklist)
+        insert(id, intern(std::move(mset)), depth);
 }
 
-bool RelationAC::flatten(Handle egraph)
+void RelationAC::flatten(const Vec<uint32_t>& touched)
 {
-    bool changed = false;
+    Worklist worklist;
 
-    Vec<std::pair<id_t, Multiset>> worklist;
-    for (const auto& [id_a, mset_a] : data)
+    for (size_t i = 0; i < touched.size() && !exhausted(); ++i)
     {
-        for (const auto& [id_b, mset_b] : data)
+        uint32_t pos = touched[i];
+        if (is_dead(pos))
+            continue;
+
+        // as b, into the tuples whose multiset contains its e-class
+        auto it = occurrences.find(data[pos].first);
+        if (it != occurrences.end())
+            for (uint32_t pos_a : it->second)
+                if (!is_dead(pos_a) && store->get(data[pos_a].second).contains(data[pos].first))
+                    flatten_into(worklist, pos_a, pos);
+
+        // as a, the tuples of the e-classes in its multiset into it
+        for (const auto& [value, count] : store->get(data[pos].second).data)
         {
-            if (mset_a.hash() == mset_b.hash())
+            auto jt = owners.find(value);
+            if (count == 0 || jt == owners.end())
                 continue;
 
-            if (mset_b.contains(id_b)) // cyclic
-                continue;
+            for (uint32_t pos_b : jt->second)
+                if (data[pos_b].first == value)
+                    flatten_into(worklist, pos, pos_b);
+        }
+    }
 
-            if (!mset_a.contains(id_b))
-                continue;
+    add_derived(worklist);
+}
 
-            // a = f(X \cup {b})
-            // b = f(Y)
-            // ~~> a = f(X \cup Y)
-            auto args = mset_a;
-            args.remove(id_b);
-            args.insert_all(mset_b);
+void RelationAC::congruence_flattened(Handle egraph)
+{
+    // The congruence table doubles as the hash-cons, which must only find
+    // stored tuples, so derived tuples meet each other in a local one. Their
+    // multisets are interned in a local store, which is dropped right after.
+    MultisetStore local;
+    HashMap<mset_id_t, id_t> derived;
+    for (const auto& [id, mset] : flattened_tuples(local))
+    {
+        mset_id_t stored = store->find(local.get(mset));
 
-            if (contains({id_a, args}))
+        auto iter = stored == MultisetStore::NONE ? classes.end() : classes.find(stored);
+        if (iter == classes.end())
+        {
+            bool inserted;
+            std::tie(iter, inserted) = derived.try_emplace(mset, id);
+            if (inserted)
                 continue;
-
-            worklist.push_back({id_a, args});
-            changed = true;
         }
-    }
 
-    for (const auto& [id, mset] : worklist)
-    {
-        ENode enode{symbol, mset.collect()};
-        egraph.add_enode_to_memo(id, enode);
-        insert({id, mset});
+        id_t lhs = egraph.canonicalize(id);
+        id_t rhs = egraph.canonicalize(iter->second);
+        iter->second = lhs == rhs ? lhs : egraph.unify(lhs, rhs);
     }
-
-    return changed;
 }
 
-bool RelationAC::unflatten(Handle egraph)
+void RelationAC::unflatten_into(Worklist& worklist, uint32_t pos_a, uint32_t pos_b)
 {
-    bool changed = false;
+    const auto& [id_a, mset_id_a] = data[pos_a];
+    const auto& [id_b, mset_id_b] = data[pos_b];
+
+    const Multiset& mset_a = store->get(mset_id_a);
+    const Multiset& mset_b = store->get(mset_id_b);
+
+    // equal sizes would mean equal multisets
+    if (mset_a.size() <= mset_b.size())
+        return;
+
+    if ((signatures[pos_b] & ~signatures[pos_a]) != 0)
+        return;
+
+    if (!mset_a.includes(mset_b))
+        return;
+
+    // a = f(X \cup Y)
+    // b = f(Y)
+    // ~~> a = f(X \cup {b})
+    auto args = mset_a.msetdiff(mset_b);
+    args.insert(id_b);
+
+    if (idempotent)
+        args.dedup();
+
+    if (contains(id_a, args))
+        return;
+
+    uint32_t depth = std::max(depths[pos_a], depths[pos_b]) + 1;
+    if (exhausted() || !admit(args, depth))
+        return;
 
-    Vec<std::pair<id_t, Multiset>> worklist;
+    worklist.push_back({id_a, std::move(args), depth});
+    ++nderived;
+}
+
+void RelationAC::unflatten(const Vec<uint32_t>& touched)
+{
+    Worklist worklist;
 
-    for (const auto& [id_a, mset_a] : data)
+    for (size_t i = 0; i < touched.size() && !exhausted(); ++i)
     {
-        for (const auto& [id_b, mset_b] : data)
-        {
-            if (mset_a.hash() == mset_b.hash())
-                continue;
+        uint32_t pos = touched[i];
+        if (is_dead(pos))
+            continue;
 
-            if (!mset_a.includes(mset_b))
-                continue;
+        const Multiset& mset = store->get(data[pos].second);
 
-            // a = f(X \cup Y)
-            // b = f(Y)
-            // ~~> a = f(X \cup {b})
-            auto args = mset_a.msetdiff(mset_b);
-            args.insert(id_b);
+        // As b, out of the tuples including its multiset. nullptr for the empty
+        // multiset as well, which is included everywhere but unflattening it
+        // would only grow the terms.
+        const auto *candidate_positions = candidates(mset);
+        if (candidate_positions != nullptr)
+        {
+            // only the buckets of larger multisets can include it, merging
+            // the fresh positions into the order is left to the indices
+            uint32_t larger = bucket(mset.size() + 1).first;
+            size_t nfresh = data.size() - order.size();
+
+            if (candidate_positions->size() <= order.size() - larger + nfresh)
+            {
+                for (uint32_t pos_a : *candidate_positions)
+                    if (!is_dead(pos_a))
+                        unflatten_into(worklist, pos_a, pos);
+            }
+            else
+            {
+                // a superset has a minimum no larger than the one of mset,
+                // the rest of a lexicographically sorted bucket can be skipped
+                id_t min = mset.min();
+                for (size_t size = mset.size() + 1; size < buckets.size(); ++size)
+                {
+                    auto [begin, end] = bucket(size);
+                    for (uint32_t j = begin; j < end && store->get(data[order[j]].second).min() <= min; ++j)
+                        if (!is_dead(order[j]))
+                            unflatten_into(worklist, order[j], pos);
+                }
+
+                for (auto pos_a = static_cast<uint32_t>(order.size()); pos_a < data.size(); ++pos_a)
+                    if (!is_dead(pos_a))
+                        unflatten_into(worklist, pos_a, pos);
+            }
+        }
 
-            if (contains({id_a, args}))
+        // as a, every multiset it includes has its minimum among its elements
+        for (const auto& [value, count] : mset.data)
+        {
+            auto it = occurrences.find(value);
+            if (count == 0 || it == occurrences.end())
                 continue;
 
-            // TODO: assert size > 1 (?)
-            worklist.push_back({id_a, args});
-            changed = true;
-        }
-    }
+            for (uint32_t pos_b : it->second)
+            {
+                if (is_dead(pos_b) || pos_b == pos)
+                    continue;
 
-    for (const auto& [id, mset] : worklist)
-    {
-        ENode enode{symbol, mset.collect()};
-        egraph.add_enode_to_memo(id, enode);
-        insert({id, mset});
+                const Multiset& mset_b = store->get(data[pos_b].second);
+                if (mset_b.size() > 0 && mset_b.min() == value)
+                    unflatten_into(worklist, pos, pos_b);
+            }
+        }
     }
 
-    return changed;
+    add_derived(worklist);
 }
 
 bool RelationAC::rebuild(Handle egraph)
 {
-    bool changed = false;
+    if (ndead > 0 && 2 * ndead >= data.size())
+        compact();
+
+    Vec<uint32_t> dirty;
+    auto mark = [&](id_t id) {
+        for (auto *postings : {&occurrences, &owners})
+        {
+            auto it = postings->find(id);
+            if (it != postings->end())
+                dirty.insert(dirty.end(), it->second.begin(), it->second.end());
+        }
+    };
 
-    canonicalize(egraph);
-    changed = congruence(egraph);
+    auto deduplicate = [](Vec<uint32_t>& list) {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    };
+
+    // At first the tuples added since the last rebuild are dirty, and the ones
+    // mentioning an id which was re-rooted since. Afterwards only the tuples
+    // which mention an id that got merged away by the previous round are.
+    dirty.resize(data.size() - nseen);
+    std::iota(dirty.begin(), dirty.end(), static_cast<uint32_t>(nseen));
+
+    egraph.sync_union_log();
+    const auto& log = egraph.union_log();
+    for (; log_cursor < log.size(); ++log_cursor)
+        mark(log[log_cursor]);
 
-    for (size_t i = 30; changed && i >= 0; --i)
+    deduplicate(dirty);
+
+    Vec<uint32_t> canonical;
+    Vec<id_t> merged;
+    while (!dirty.empty())
     {
-        changed = canonicalize(egraph);
-        if (changed)
-            changed = congruence(egraph);
+        // the unit's e-class may have been merged into another one, whose
+        // id has to be dropped from the tuples now
+        if (unit.has_value() && egraph.canonicalize(*unit) != *unit)
+        {
+            unit = egraph.canonicalize(*unit);
+
+            auto it = occurrences.find(*unit);
+            if (it != occurrences.end())
+                dirty.insert(dirty.end(), it->second.begin(), it->second.end());
+
+            deduplicate(dirty);
+        }
+
+        // stale tuples move to the end, which keeps them dirty for flattening
+        canonical.clear();
+        for (uint32_t pos : dirty)
+        {
+            if (is_dead(pos))
+                continue;
+
+            uint32_t moved = canonicalize(egraph, pos);
+            if (moved != NIL)
+                canonical.push_back(moved);
+        }
+
+        congruence(egraph, canonical, merged);
+
+        dirty.clear();
+        for (id_t id : merged)
+            mark(id);
+
+        merged.clear();
+        deduplicate(dirty);
     }
 
-    flatten(egraph);
-    unflatten(egraph);
+    // the tuples appended since the last rebuild, the canonicalized ones
+    // included, and the ones a truncated rebuild did not get to
+    Vec<uint32_t> touched = std::move(deferred);
+    deferred.clear();
+    for (size_t pos = nseen; pos < data.size(); ++pos)
+        touched.push_back(static_cast<uint32_t>(pos));
+
+    deduplicate(touched);
+
+    // the unions of this rebuild were handled through merged, while the
+    // tuples derived below are canonicalized by the next rebuild
+    egraph.sync_union_log();
+    log_cursor = egraph.union_log().size();
+    nseen = data.size();
+
+    nderived = 0;
+    truncated = false;
+
+    if (lazy)
+        congruence_flattened(egraph);
+    else
+        flatten(touched);
+
+    unflatten(touched);
+
+    // the pairs skipped for the derived tuple limit are tried again next time
+    if (truncated)
+        deferred = std::move(touched);
+
+    // The derived tuples meet the congruence table right away. They stay
+    // dirty, so the next rebuild canonicalizes them, and it repairs the
+    // tuples of the e-classes merged here through the union log.
+    dirty.resize(data.size() - nseen);
+    std::iota(dirty.begin(), dirty.end(), static_cast<uint32_t>(nseen));
+    congruence(egraph, dirty, merged);
 
     return true;
 }
 
 void RelationAC::dump(std::ofstream& out, const SymbolTable& symbols) const
 {
-    out << "---- " << symbols.get_string(symbol) << "(AC) with " << size() << " tuples ----" << std::endl;
+    out << "---- " << symbols.get_string(symbol) << (idempotent ? "(ACI)" : "(AC)") << " with " << size()
+        << " tuples ----" << std::endl;
 
-    for (const auto& [eclass_id, mset] : data)
+    for (const auto& [eclass_id, mset_id] : data)
     {
+        if (eclass_id == TOMBSTONE)
+            continue;
+
         out << "eclass-id: " << eclass_id << "  mset: {{";
 
         bool first = true;
-        for (const auto& [id, count] : mset.data)
+        for (const auto& [id, count] : store->get(mset_id).data)
         {
             if (!first)
                 out << ", ";
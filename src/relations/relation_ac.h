@@ -1,37 +1,327 @@
 #pragma once
 
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <tuple>
 #include <utility>
 
 #include "handle.h"
 #include "indices/abstract_index.h"
+#include "relations/ac_limits.h"
 #include "symbol_table.h"
 #include "utils/multiset.h"
+#include "utils/multiset_store.h"
 
 namespace eqsat
 {
 
-// TODO: sort multisets lexicographically or by size to get early pruning
-
+/**
+ * @brief Relation storing AC tuples `op({args...}; eclass_id)`
+ *
+ * The argument multisets are interned in a MultisetStore, which is shared by
+ * all AC relations of a database and by their indices. A tuple is therefore
+ * just a pair of e-class id and multiset id, and two tuples are equal iff both
+ * ids are equal. Tuples are appended to a flat vector, their position doubles
+ * as the term-id used during matching. Deduplication goes through a hash index
+ * keyed by the exact pair of ids. Insertion and lookup are amortized O(1).
+ *
+ * Additionally an inverted index maps every element id to the positions of the
+ * tuples whose multiset contains it. Flattening joins the e-class ids of the
+ * tuples against this index instead of comparing all pairs of tuples.
+ *
+ * Congruence closure is worklist driven. A persistent congruence table maps
+ * every multiset seen so far to an e-class. A rebuild only visits the tuples
+ * added since the previous one, and the tuples mentioning an id which stopped
+ * being canonical because of a union (found through the element and e-class
+ * postings). Like RowStore, the relation keeps a cursor into the union log of
+ * the union-find to learn about the unions done since it last looked. Every
+ * stored tuple enters the congruence table when it is inserted, so the table
+ * doubles as the hash-cons of the relation (see lookup).
+ *
+ * Tuples are never changed in place. Canonicalizing a tuple drops it, leaving
+ * a tombstone at its position, and appends the canonical tuple, so the keys and
+ * the sort order (see below) of the other tuples stay valid. The positions are
+ * compacted once half of them are dead. Flattening and unflattening are
+ * semi-naive, only pairs of tuples of which at least one was appended since
+ * the last rebuild are joined. Without lazy flattening the cost of a rebuild
+ * thus scales with the number of changes and their postings, not the relation
+ * size.
+ *
+ * Unflattening needs the opposite direction, all tuples whose multiset includes
+ * a given one. Candidates are taken from the shortest posting list among the
+ * elements of the smaller multiset, and are filtered by size and by a 64-bit
+ * Bloom signature of their support before the exact inclusion test runs.
+ *
+ * On top of the positions the relation keeps an order of the tuples bucketed
+ * by the size of their multisets and lexicographic within a bucket (see
+ * Multiset::operator<). Unflattening scans the buckets of larger multisets
+ * instead of the posting list when they are shorter, and stops scanning a
+ * bucket at the first multiset whose minimum exceeds the one it looks for.
+ * Indices number the terms in this order, so matching a pattern with k
+ * children starts right at the first term with k children.
+ *
+ * With lazy flattening the flattened tuples are never stored and never enter
+ * the hash-cons or the shared store. They are derived again, up to
+ * ACLimits::max_lazy of them, for every index and for congruence, and their
+ * multisets live in a store owned by the index or by the rebuild. So memory
+ * is only spent on them while an index is alive, in exchange for deriving the
+ * closure again on every index and rebuild. A derived tuple is not flattened
+ * through an e-class which was already flattened into it, which only happens
+ * on a cycle and keeps the closure finite. A match on a flattened tuple yields
+ * the e-class of the tuple it was derived from (see MultisetIndex::selected_eclass).
+ *
+ * The store is swept from time to time (see mark_multisets), so only the
+ * multisets of stored tuples and of live indices outlast a rebuild.
+ *
+ * An ACU relation knows the e-class of its operator's unit. Canonicalization
+ * drops the unit from every multiset, and a tuple left with fewer than two
+ * children is unified with its only child, or with the unit if it has none,
+ * and then dropped. The index treats the unit as implicitly present.
+ *
+ * An ACI relation stores sets. Every count is clamped to one whenever a
+ * multiset is built, so the sorted (id, count) vector doubles as a sorted set
+ * and interning, fingerprints and the inclusion tests of unflattening all see
+ * the set. Since `op(x, x) = op(x) = x`, singletons collapse like ACU ones.
+ *
+ * Flattening and unflattening respect the ACLimits of the relation. Every
+ * tuple remembers its depth, the number of derivation steps it is away from
+ * the tuples added from outside, which are at depth zero.
+ */
 class RelationAC
 {
   private:
-    Vec<std::pair<id_t, Multiset>> data;
+    // marks a dropped tuple in its e-class id
+    static constexpr id_t TOMBSTONE = ~static_cast<id_t>(0);
+    // no position
+    static constexpr uint32_t NIL = ~static_cast<uint32_t>(0);
+
+    // derived tuples (e-class id, children, depth) waiting to be added
+    using Worklist = Vec<std::tuple<id_t, Multiset, uint32_t>>;
+
+    Vec<std::pair<id_t, mset_id_t>> data;
     Symbol symbol;
+    std::shared_ptr<MultisetStore> store;
+
+    // (e-class id, multiset id) --> position
+    HashMap<uint64_t, uint32_t> positions;
+
+    // element id --> positions of the tuples whose multiset contains it, may be stale
+    HashMap<id_t, Vec<uint32_t>> occurrences;
+    // e-class id --> positions of the tuples in that e-class, may be stale
+    HashMap<id_t, Vec<uint32_t>> owners;
+    // multiset id --> e-class of some tuple with that multiset, the hash-cons
+    HashMap<mset_id_t, id_t> classes;
+    // position --> Bloom signature of the support of its multiset
+    Vec<uint64_t> signatures;
+    // position --> number of derivation steps behind the tuple
+    Vec<uint32_t> depths;
+    // positions sorted by their multisets, fresh positions are merged in lazily
+    // and dead ones are only dropped by compact, their multisets stay alive
+    Vec<uint32_t> order;
+    // size s --> first index into order whose multiset has at least s elements
+    Vec<uint32_t> buckets;
+    // canonical e-class of the unit, for ACU operators
+    std::optional<id_t> unit;
+    // ACI operators store sets instead of multisets
+    bool idempotent;
+    // derive flattened tuples on demand instead of storing them
+    bool lazy = false;
+
+    ACLimits limits;
+    ACLimitCounters counters;
+    // how much of the union-find log has already been processed
+    size_t log_cursor = 0;
+    // positions below this have been canonicalized and entered the congruence table
+    size_t nseen = 0;
+    size_t ndead = 0;
+    // appended positions whose derivations a truncated rebuild did not finish
+    Vec<uint32_t> deferred;
+
+    // tuples derived by the current rebuild, and whether it ran out of them
+    size_t nderived = 0;
+    bool truncated = false;
+
+    static uint64_t key(id_t id, mset_id_t mset)
+    {
+        return (static_cast<uint64_t>(id) << 32) | mset;
+    }
+
+    bool is_dead(uint32_t pos) const
+    {
+        return data[pos].first == TOMBSTONE;
+    }
+
+    /**
+     * @brief Drop the tuple at pos from the hash index, it keeps its multiset until compact
+     */
+    void kill(uint32_t pos)
+    {
+        positions.erase(key(data[pos].first, data[pos].second));
+        data[pos].first = TOMBSTONE;
+        ++ndead;
+    }
+
+    /**
+     * @brief Renumber the live positions without gaps and rebuild the postings
+     *
+     * Only called once dead tuples make up at least half of the positions,
+     * which keeps the cost amortized constant per dropped tuple.
+     */
+    void compact();
 
-    bool insert(std::pair<id_t, Multiset> tuple);
-    bool contains(std::pair<id_t, Multiset> tuple);
-    void sort();
-    bool canonicalize(const Handle egraph);
-    bool congruence(Handle egraph);
-    bool flatten(Handle egraph);
-    bool unflatten(Handle egraph);
-    void deduplicate();
+    /**
+     * @brief One bit per distinct element, a superset of a multiset
+     *        always has a superset of its signature bits
+     */
+    static uint64_t signature(const Multiset& mset)
+    {
+        uint64_t sig = 0;
+        for (const auto& [value, count] : mset.data)
+            if (count > 0)
+                sig |= uint64_t{1} << (hash64(value) & 63);
+
+        return sig;
+    }
+
+    /**
+     * @brief Get the positions of all tuples which possibly include mset
+     *
+     * Returns the shortest posting list among the elements of mset,
+     * or nullptr if some element does not occur in any tuple.
+     */
+    const Vec<uint32_t> *candidates(const Multiset& mset) const;
+
+    /**
+     * @brief Check whether a tuple stands for one of its children or the unit
+     *
+     * True for `op()` in ACU relations and for `op(x)` in ACU and ACI relations.
+     */
+    bool collapses(const Multiset& mset) const
+    {
+        return mset.size() < 2 && (unit.has_value() || (idempotent && mset.size() == 1));
+    }
+
+    /**
+     * @brief Intern a multiset, as a set for ACI relations
+     */
+    mset_id_t intern(Multiset mset)
+    {
+        if (idempotent)
+            mset.dedup();
+
+        return store->intern(std::move(mset));
+    }
+
+    bool insert(id_t id, mset_id_t mset, uint32_t depth = 0);
+
+    /**
+     * @brief Check the size and depth limits for a derived tuple, counting violations
+     */
+    bool admit(const Multiset& args, uint32_t depth);
+
+    /**
+     * @brief Check whether the current rebuild may not derive any more tuples
+     */
+    bool exhausted();
+    bool contains(id_t id, const Multiset& mset) const;
+
+    /**
+     * @brief Merge the positions added since the last call into order and refresh the buckets
+     */
+    void sort_by_size();
+
+    /**
+     * @brief Recompute the buckets of order by a binary search per size
+     */
+    void index_buckets();
+
+    /**
+     * @brief Get the range of order holding the multisets with exactly size elements
+     */
+    std::pair<uint32_t, uint32_t> bucket(size_t size) const
+    {
+        auto end = static_cast<uint32_t>(order.size());
+        if (size >= buckets.size())
+            return {end, end};
+
+        return {buckets[size], size + 1 < buckets.size() ? buckets[size + 1] : end};
+    }
+
+    /**
+     * @brief Canonicalize the tuple at pos
+     *
+     * A stale tuple is dropped and its canonical version appended, which
+     * registers it under the new ids in the hash index and the postings.
+     *
+     * @return The position of the canonical tuple, NIL if it was stored already
+     */
+    uint32_t canonicalize(const Handle egraph, uint32_t pos);
+
+    /**
+     * @brief Look up the given tuples in the congruence table and unify on hits
+     *
+     * Collapsing tuples are unified with their child or the unit and dropped.
+     *
+     * @param merged Receives the ids which stopped being canonical
+     */
+    void congruence(Handle egraph, const Vec<uint32_t>& dirty, Vec<id_t>& merged);
+
+    /**
+     * @brief Queue the flattening of b into a, see flatten
+     */
+    void flatten_into(Worklist& worklist, uint32_t pos_a, uint32_t pos_b);
+
+    /**
+     * @brief Queue the unflattening of b out of a, see unflatten
+     */
+    void unflatten_into(Worklist& worklist, uint32_t pos_a, uint32_t pos_b);
+
+    /**
+     * @brief Flatten the pairs of tuples involving one of the touched ones
+     */
+    void flatten(const Vec<uint32_t>& touched);
+
+    /**
+     * @brief Unflatten the pairs of tuples involving one of the touched ones
+     */
+    void unflatten(const Vec<uint32_t>& touched);
+
+    /**
+     * @brief Add the derived tuples, interning their multisets only now
+     */
+    void add_derived(Worklist& worklist);
+
+    /**
+     * @brief Derive the flattened tuples which are not stored, without adding them
+     *
+     * Flattens the derived tuples further, but never through an e-class
+     * already flattened into them, and stops with a count once there are
+     * ACLimits::max_lazy of them. The size and depth limits apply as for
+     * stored tuples.
+     *
+     * @param local Receives the multisets of the derived tuples, the shared store is left alone
+     */
+    Vec<std::pair<id_t, mset_id_t>> flattened_tuples(MultisetStore& local);
+
+    /**
+     * @brief Look up the flattened tuples in the congruence table and unify on hits
+     *
+     * Replaces flatten with lazy flattening, so associativity still merges e-classes.
+     */
+    void congruence_flattened(Handle egraph);
 
   public:
     RelationAC(Symbol symbol)
+        : RelationAC(symbol, std::make_shared<MultisetStore>())
+    {
+    }
+
+    RelationAC(Symbol symbol, std::shared_ptr<MultisetStore> store, bool idempotent = false)
         : data()
         , symbol(symbol)
+        , store(std::move(store))
+        , idempotent(idempotent)
     {
     }
 
@@ -42,12 +332,73 @@ class RelationAC
 
     size_t size() const
     {
-        return data.size();
+        return data.size() - ndead;
     }
 
     void add_tuple(const Vec<id_t>& tuple);
     void add_tuple(id_t id, Multiset mset);
 
+    /**
+     * @brief Find the e-class of the term with the given children, in any order
+     *
+     * Derived tuples are found as well, flattened ones only if they are stored.
+     */
+    std::optional<id_t> lookup(const Vec<id_t>& args) const;
+
+    /**
+     * @brief Call f(children, nchildren, eclass) for each stored tuple, repeated children included
+     */
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        for (const auto& [id, mset] : data)
+        {
+            if (id == TOMBSTONE)
+                continue;
+
+            auto args = store->get(mset).collect();
+            f(args.data(), args.size(), id);
+        }
+    }
+
+    /**
+     * @brief Make this an ACU relation whose unit lives in the given e-class
+     */
+    void set_unit(id_t id)
+    {
+        unit = id;
+    }
+
+    /**
+     * @brief Switch between storing flattened tuples and deriving them on demand
+     */
+    void set_lazy_flattening(bool enabled)
+    {
+        lazy = enabled;
+    }
+
+    /**
+     * @brief Mark the multisets of the stored tuples as live in the shared store
+     *
+     * Dropped tuples count until compact, the sort order still compares them.
+     * Congruence table entries of multisets which are not live by now are
+     * dropped. Those multisets mention an id which got merged away, so
+     * canonical lookups would never find them again.
+     *
+     * @param live One flag per multiset id of the store, see MultisetStore::sweep
+     */
+    void mark_multisets(Vec<bool>& live);
+
+    void set_limits(const ACLimits& new_limits)
+    {
+        limits = new_limits;
+    }
+
+    const ACLimitCounters& limit_counters() const
+    {
+        return counters;
+    }
+
     AbstractIndex populate_index(uint32_t);
 
     bool rebuild(Handle egraph);
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cassert>
+
+#include "relations/relation_c.h"
+#include "utils/permutation.h"
+
+namespace eqsat
+{
+
+uint32_t RelationC::normalize_permutation(uint32_t perm) const
+{
+    auto columns = index_to_permutation(perm, {0, 1, 2});
+
+    auto first = std::find(columns.begin(), columns.end(), 0);
+    auto second = std::find(columns.begin(), columns.end(), 1);
+    if (second < first)
+        std::iter_swap(first, second);
+
+    return permutation_to_index(columns);
+}
+
+AbstractIndex RelationC::populate_index(uint32_t vo)
+{
+    assert(normalize_permutation(vo) == vo);
+
+    auto columns = index_to_permutation(vo, {0, 1, 2});
+
+    // below the e-class the partners are found among its few tuples
+    std::shared_ptr<ArgumentPairs> pairs = nullptr;
+    if (columns.front() != 2)
+    {
+        pairs = std::make_shared<ArgumentPairs>();
+
+        Vec<std::pair<id_t, id_t>> larger;
+        rows.for_each_tuple([&](const id_t *tuple) {
+            pairs->arguments.push_back(tuple[0]);
+            pairs->arguments.push_back(tuple[1]);
+
+            if (tuple[0] != tuple[1])
+                larger.push_back({tuple[1], tuple[0]});
+        });
+
+        std::sort(pairs->arguments.begin(), pairs->arguments.end());
+        pairs->arguments.erase(std::unique(pairs->arguments.begin(), pairs->arguments.end()), pairs->arguments.end());
+
+        std::sort(larger.begin(), larger.end());
+        larger.erase(std::unique(larger.begin(), larger.end()), larger.end());
+
+        for (const auto& [key, partner] : larger)
+        {
+            if (pairs->keys.empty() || pairs->keys.back() != key)
+            {
+                pairs->keys.push_back(key);
+                pairs->offsets.push_back(static_cast<uint32_t>(pairs->partners.size()));
+            }
+            pairs->partners.push_back(partner);
+        }
+        pairs->offsets.push_back(static_cast<uint32_t>(pairs->partners.size()));
+    }
+
+    return AbstractIndex(CommutativeIndex(get_symbol(), rows.build_trie(vo), std::move(pairs), std::move(columns)));
+}
+
+void RelationC::dump(std::ofstream& out, const SymbolTable& symbols) const
+{
+    out << "---- " << symbols.get_string(get_symbol()) << "(C) with " << size() << " tuples ----\n";
+
+    rows.for_each_tuple([&](const id_t *tuple) {
+        out << "eclass-id: " << tuple[2] << "  args: " << tuple[0] << ", " << tuple[1] << std::endl;
+    });
+
+    out << std::endl;
+}
+
+} // namespace eqsat
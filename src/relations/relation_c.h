@@ -0,0 +1,110 @@
+#pragma once
+
+#include <fstream>
+#include <optional>
+#include <utility>
+
+#include "handle.h"
+#include "indices/abstract_index.h"
+#include "relations/row_store.h"
+#include "symbol_table.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Relation storing tuples `op(arg1, arg2; eclass_id)` of a commutative binary operator
+ *
+ * Commutative, non-associative operators (`nand`, `xor`, ...) are stored in a
+ * commutative RowStore of arity 3, which keeps the two arguments of every tuple
+ * sorted. `op(a, b)` and `op(b, a)` are thus one and the same tuple, and
+ * rebuilding detects their congruence like for any other operator, without a
+ * commutativity rule doubling the relation.
+ *
+ * Patterns still have to match both argument orders. The index of a column
+ * order is a CommutativeIndex, a single trie over the sorted tuples whose
+ * argument levels project the union of both orders, so a C constraint is
+ * matched in one pass against one index. The orders which only differ in the
+ * two argument columns share that index (see normalize_permutation). Besides
+ * the trie, an index which starts with the arguments keeps the smaller
+ * partners of each larger argument (see ArgumentPairs), one id per tuple
+ * with two distinct arguments, to find the tuples in which an argument
+ * comes second.
+ */
+class RelationC
+{
+  private:
+    RowStore rows;
+
+  public:
+    explicit RelationC(Symbol symbol)
+        : rows(symbol, 3, /* commutative: */ true)
+    {
+    }
+
+    size_t size() const
+    {
+        return rows.size();
+    }
+
+    /**
+     * @brief Add a tuple `(arg1, arg2, eclass_id)`, the arguments may come in any order
+     */
+    void add_tuple(const Vec<id_t>& tuple)
+    {
+        rows.add_tuple(tuple);
+    }
+
+    /**
+     * @brief Find the e-class of the term with the given arguments, in any order
+     */
+    std::optional<id_t> lookup(const Vec<id_t>& args) const
+    {
+        return rows.lookup(args);
+    }
+
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        rows.for_each_term(f);
+    }
+
+    Symbol get_symbol() const
+    {
+        return rows.get_symbol();
+    }
+
+    /**
+     * @brief Map a permutation to the one with the first argument column ahead of the second
+     *
+     * The index yields both argument orders, so the two permutations which
+     * only differ in the order of the argument columns share it.
+     */
+    uint32_t normalize_permutation(uint32_t perm) const;
+
+    /**
+     * @brief Build a CommutativeIndex over the tuples with sorted arguments
+     *
+     * @param vo Permutation of the columns, normalized
+     */
+    AbstractIndex populate_index(uint32_t vo);
+
+    bool rebuild(Handle handle)
+    {
+        return rows.rebuild(handle);
+    }
+
+    void collect_unions(const Handle handle, Vec<std::pair<id_t, id_t>>& unions)
+    {
+        rows.collect_unions(handle, unions);
+    }
+
+    size_t pending(const Handle handle) const
+    {
+        return rows.pending(handle);
+    }
+
+    void dump(std::ofstream& out, const SymbolTable& symbols) const;
+};
+
+} // namespace eqsat
@@ -1,5 +1,4 @@
 #include <algorithm>
-#include <cstdlib>
 
 #include "handle.h"
 #include "indices/abstract_index.h"
@@ -10,7 +9,7 @@
 namespace eqsat
 {
 
-AbstractIndex RowStore::populate_index(uint32_t vo)
+std::shared_ptr<TrieNode> RowStore::build_trie(uint32_t vo) const
 {
     auto trie = std::make_shared<TrieNode>();
 
@@ -22,138 +21,266 @@ AbstractIndex RowStore::populate_index(uint32_t vo)
     auto permuted_indices = index_to_permutation(vo, iota);
 
     Vec<id_t> buffer(arity);
-    const id_t *base = data.data();
-    for (size_t i = 0; i < size(); ++i)
-    {
-        const id_t *tuple = base + i * arity;
+    for_each_tuple([&](const id_t *tuple) {
         std::copy(tuple, tuple + arity, buffer.begin());
         apply_permutation(permuted_indices, buffer);
         trie->insert_path(buffer);
+    });
+
+    return trie;
+}
+
+AbstractIndex RowStore::populate_index(uint32_t vo)
+{
+    return AbstractIndex(TrieIndex(symbol, build_trie(vo)));
+}
+
+uint64_t RowStore::hash_arguments(const id_t *args) const
+{
+    uint64_t h = hash64(arity);
+    for (size_t i = 0; i + 1 < arity; ++i)
+        h = mix64(h, args[i]);
+
+    return h;
+}
+
+void RowStore::link(uint32_t slot)
+{
+    auto [it, inserted] = heads.try_emplace(hash_arguments(row(slot)), slot);
+
+    next[slot] = inserted ? NIL : it->second;
+    it->second = slot;
+}
+
+void RowStore::unlink(uint32_t slot)
+{
+    auto it = heads.find(hash_arguments(row(slot)));
+    assert(it != heads.end());
+
+    if (it->second == slot)
+    {
+        if (next[slot] == NIL)
+            heads.erase(it);
+        else
+            it->second = next[slot];
+
+        return;
     }
 
-    return AbstractIndex(TrieIndex(symbol, trie));
+    uint32_t prev = it->second;
+    while (next[prev] != slot)
+    {
+        assert(next[prev] != NIL);
+        prev = next[prev];
+    }
+
+    next[prev] = next[slot];
 }
 
-// Comparison context for qsort
-struct TupleCompareContext
+std::optional<id_t> RowStore::lookup(const Vec<id_t>& args) const
 {
-    size_t arity;
-};
+    assert(args.size() + 1 == arity);
+
+    Vec<id_t> key(args.begin(), args.end());
+    key.push_back(0);
+    sort_arguments(key.data());
 
-// qsort comparison function for tuples
-// Compares first (arity - 1) elements, ignoring the last element (ID)
-static int tuple_compare(const void *a, const void *b, void *context)
+    auto it = heads.find(hash_arguments(key.data()));
+    if (it == heads.end())
+        return std::nullopt;
+
+    for (uint32_t slot = it->second; slot != NIL; slot = next[slot])
+        if (std::equal(key.begin(), key.end() - 1, row(slot)))
+            return row(slot)[arity - 1];
+
+    return std::nullopt;
+}
+
+int RowStore::compare(uint32_t lhs, uint32_t rhs, size_t ncolumns) const
 {
-    const id_t *tuple1 = static_cast<const id_t *>(a);
-    const id_t *tuple2 = static_cast<const id_t *>(b);
-    const TupleCompareContext *ctx = static_cast<const TupleCompareContext *>(context);
+    const id_t *tuple1 = row(lhs);
+    const id_t *tuple2 = row(rhs);
 
-    // Compare first (arity - 1) elements
-    for (size_t i = 0; i < ctx->arity - 1; ++i)
+    for (size_t i = 0; i < ncolumns; ++i)
     {
         if (tuple1[i] < tuple2[i])
             return -1;
         if (tuple1[i] > tuple2[i])
             return 1;
     }
-    return 0; // Equal
+
+    return 0;
 }
 
-void RowStore::deduplicate()
+uint32_t RowStore::find_duplicate(uint32_t slot) const
 {
-    if (data.empty())
-        return;
+    auto it = heads.find(hash_arguments(row(slot)));
+    assert(it != heads.end());
 
-    const size_t num_tuples = size();
-    if (num_tuples <= 1)
-        return;
+    const id_t *tuple = row(slot);
+    for (uint32_t other = it->second; other != NIL; other = next[other])
+    {
+        if (other == slot || compare(other, slot, arity - 1) != 0)
+            continue;
+
+        if (arity > 1 || row(other)[0] == tuple[0])
+            return other;
+    }
+
+    return NIL;
+}
+
+Vec<uint32_t> RowStore::collect_affected(const Handle handle)
+{
+    Vec<uint32_t> affected;
+
+    // slots mentioning an id which was re-rooted since the last call
+    const auto& log = handle.union_log();
+    for (; log_cursor < log.size(); ++log_cursor)
+    {
+        auto it = uses.find(log[log_cursor]);
+        if (it == uses.end())
+            continue;
+
+        // entries can be stale, the slot might have died in the meantime
+        for (uint32_t slot : it->second)
+            if (!is_dead(slot))
+                affected.push_back(slot);
 
-    size_t write_idx = 0;
-    size_t read_idx = arity;
+        uses.erase(it);
+    }
+
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
 
-    // Keep first tuple, compare rest
-    while (read_idx < data.size())
+    // only register ids which changed, the others are still in the index
+    for (uint32_t slot : affected)
     {
-        const id_t *current = &data[write_idx];
-        const id_t *candidate = &data[read_idx];
+        unlink(slot);
 
-        // Check if all arity elements are identical
-        bool is_duplicate = true;
+        id_t *tuple = row(slot);
         for (size_t i = 0; i < arity; ++i)
         {
-            if (current[i] != candidate[i])
+            id_t id = handle.canonicalize(tuple[i]);
+            if (id != tuple[i])
             {
-                is_duplicate = false;
-                break;
+                tuple[i] = id;
+                uses[id].push_back(slot);
             }
         }
 
-        if (!is_duplicate)
+        sort_arguments(tuple);
+        link(slot);
+    }
+
+    for (uint32_t slot : fresh)
+    {
+        unlink(slot);
+
+        id_t *tuple = row(slot);
+        for (size_t i = 0; i < arity; ++i)
         {
-            // Move to next write position and copy tuple
-            write_idx += arity;
-            if (write_idx != read_idx)
-            {
-                for (size_t i = 0; i < arity; ++i)
-                    data[write_idx + i] = candidate[i];
-            }
+            tuple[i] = handle.canonicalize(tuple[i]);
+            uses[tuple[i]].push_back(slot);
         }
 
-        read_idx += arity;
+        sort_arguments(tuple);
+        link(slot);
+        affected.push_back(slot);
     }
 
-    // Resize to remove duplicates
-    data.resize(write_idx + arity);
+    fresh.clear();
+
+    // a fixed order keeps the unions independent of the slot layout
+    auto less = [this](uint32_t lhs, uint32_t rhs) { return compare(lhs, rhs, arity) < 0; };
+    std::sort(affected.begin(), affected.end(), less);
+
+    return affected;
 }
 
-bool RowStore::rebuild(Handle handle)
+void RowStore::resolve_collisions(const Vec<uint32_t>& affected, Vec<std::pair<id_t, id_t>>& unions)
 {
-    for (auto& id : data)
-        id = handle.canonicalize(id);
+    for (uint32_t slot : affected)
+    {
+        // a slot can collide with several others which were merged at once
+        while (!is_dead(slot))
+        {
+            uint32_t other = find_duplicate(slot);
+            if (other == NIL)
+                break;
 
-    if (arity <= 1)
-        return false; // Nothing to rebuild if only ID column
+            uint32_t winner = compare(other, slot, arity) < 0 ? other : slot;
+            uint32_t loser = winner == slot ? other : slot;
 
-    const size_t num_tuples = size();
-    if (num_tuples <= 1)
-        return false; // Nothing to compare
+            id_t id1 = row(winner)[arity - 1];
+            id_t id2 = row(loser)[arity - 1];
 
-    bool did_something = false;
+            // the loser of the unification gets revisited through the union log
+            if (id1 != id2)
+                unions.push_back({id1, id2});
+
+            kill(loser);
+        }
+    }
+}
+
+void RowStore::compact()
+{
+    assert(fresh.empty());
 
-    // Sort tuples by first (arity - 1) elements using qsort_r
-    TupleCompareContext ctx{arity};
-    qsort_r(data.data(), num_tuples, arity * sizeof(id_t), tuple_compare, &ctx);
+    Vec<id_t> compacted;
+    compacted.reserve(size() * arity);
 
-    // Find neighboring tuples with identical arguments but different IDs
-    for (size_t i = 0; i + 1 < num_tuples; ++i)
+    for_each_tuple([&](const id_t *tuple) { compacted.insert(compacted.end(), tuple, tuple + arity); });
+
+    data.swap(compacted);
+    uses.clear();
+    heads.clear();
+    next.assign(data.size() / arity, NIL);
+    ndead = 0;
+
+    for (uint32_t slot = 0; slot < next.size(); ++slot)
     {
-        id_t id1, id2, newid;
-        id_t *tuple1 = &data[i * arity];
-        id_t *tuple2 = &data[(i + 1) * arity];
+        const id_t *tuple = row(slot);
+        for (size_t i = 0; i < arity; ++i)
+            uses[tuple[i]].push_back(slot);
 
-        for (size_t j = 0; j < arity - 1; ++j)
-            if (tuple1[j] != tuple2[j])
-                goto next_tuple;
+        link(slot);
+    }
+}
 
-        id1 = tuple1[arity - 1];
-        id2 = tuple2[arity - 1];
+void RowStore::collect_unions(const Handle handle, Vec<std::pair<id_t, id_t>>& unions)
+{
+    auto affected = collect_affected(handle);
 
-        if (id1 == id2)
-            continue;
+    resolve_collisions(affected, unions);
+
+    if (2 * ndead >= data.size() / arity && ndead > 0)
+        compact();
+}
+
+bool RowStore::rebuild(Handle handle)
+{
+    bool did_something = false;
 
-        newid = handle.unify(id1, id2);
+    // Unifications append to the union log, so keep
+    // going until this relation has caught up with itself.
+    Vec<std::pair<id_t, id_t>> unions;
+    while (true)
+    {
+        unions.clear();
+        handle.sync_union_log();
+        collect_unions(handle, unions);
 
-        tuple1[arity - 1] = newid;
-        tuple2[arity - 1] = newid;
+        if (unions.empty())
+            break;
 
-        did_something = true;
+        for (const auto& [a, b] : unions)
+            handle.unify(a, b);
 
-    next_tuple:;
+        did_something = true;
     }
 
-    // Remove duplicate tuples created by unification
-    deduplicate();
-
     return did_something;
 }
 
@@ -161,10 +288,8 @@ void RowStore::dump(std::ofstream& out, const SymbolTable& symbols) const
 {
     out << "---- " << symbols.get_string(symbol) << "(" << arity - 1 << ") with " << size() << " tuples ----\n";
 
-    const id_t *base = data.data();
-    for (size_t i = 0; i < size(); ++i)
-    {
-        const id_t *tuple = base + i * arity;
+    auto dump_slot = [&](uint32_t slot) {
+        const id_t *tuple = row(slot);
         auto id = tuple[arity - 1];
         out << "eclass-id: " << id;
         if (arity > 1)
@@ -176,7 +301,13 @@ void RowStore::dump(std::ofstream& out, const SymbolTable& symbols) const
                 out << ", ";
         }
         out << std::endl;
-    }
+    };
+
+    auto nslots = static_cast<uint32_t>(data.size() / arity);
+    for (uint32_t slot = 0; slot < nslots; ++slot)
+        if (!is_dead(slot))
+            dump_slot(slot);
+
     out << std::endl;
 }
 
@@ -2,6 +2,8 @@
 
 #include <cassert>
 #include <fstream>
+#include <optional>
+#include <utility>
 
 #include "handle.h"
 #include "indices/abstract_index.h"
@@ -10,26 +12,152 @@
 namespace eqsat
 {
 
+/**
+ * @brief Relation storing fixed-arity tuples `op(arg1, ..., argN; eclass_id)`
+ *
+ * Tuples live in stable slots of a flat buffer and are never moved, except when
+ * the buffer is compacted. On top of the slots the relation keeps:
+ *
+ * - the **fresh** slots: tuples added since the last rebuild
+ * - the **uses** index: e-class id --> slots whose tuple mentions it
+ * - the **hash-cons**: argument columns --> live slots with those arguments
+ *
+ * Rebuilding is incremental. The relation remembers how much of the union-find
+ * log it has already seen, and only the tuples which mention a re-rooted id
+ * (found through the uses index) or which are fresh get re-canonicalized.
+ * Each of them is then probed in the hash-cons for another live tuple with
+ * the same arguments, so the cost of a rebuild scales with the number of
+ * merges, not with the size of the relation.
+ *
+ * The hash-cons chains the slots sharing the hash of their arguments through
+ * a per-slot link, like MultisetStore does for multisets. It is the only
+ * place where the e-graph looks up terms of the relation (see lookup), so
+ * every term is stored once. Slots are unlinked before their arguments are
+ * re-canonicalized and linked again afterwards, dead slots are never linked.
+ *
+ * A commutative row store keeps the two argument columns of its binary tuples
+ * sorted, also across canonicalization, so both argument orders of a term end
+ * up in the same tuple (see RelationC).
+ */
 class RowStore
 {
   private:
+    // marks a dead slot in its e-class id column
+    static constexpr id_t TOMBSTONE = ~static_cast<id_t>(0);
+    // ends a chain of the hash-cons
+    static constexpr uint32_t NIL = ~static_cast<uint32_t>(0);
+
     Vec<id_t> data;
     size_t arity;
     Symbol symbol;
+    bool commutative;
+
+    Vec<uint32_t> fresh;
+    HashMap<id_t, Vec<uint32_t>> uses;
+
+    // hash of the argument columns --> most recently linked slot with that hash
+    HashMap<uint64_t, uint32_t> heads;
+    // slot --> next slot in the same chain
+    Vec<uint32_t> next;
+
+    // how much of the union-find log has already been processed
+    size_t log_cursor = 0;
+    size_t ndead = 0;
+
+    id_t *row(uint32_t slot)
+    {
+        return data.data() + slot * arity;
+    }
+
+    const id_t *row(uint32_t slot) const
+    {
+        return data.data() + slot * arity;
+    }
+
+    bool is_dead(uint32_t slot) const
+    {
+        return row(slot)[arity - 1] == TOMBSTONE;
+    }
+
+    void kill(uint32_t slot)
+    {
+        unlink(slot);
+        row(slot)[arity - 1] = TOMBSTONE;
+        ++ndead;
+    }
+
+    void sort_arguments(id_t *tuple) const
+    {
+        if (commutative && tuple[0] > tuple[1])
+            std::swap(tuple[0], tuple[1]);
+    }
+
+    uint64_t hash_arguments(const id_t *args) const;
 
     /**
-     * @brief Remove duplicate tuples from the relation
+     * @brief Add a live slot to the chain of its arguments in the hash-cons
+     */
+    void link(uint32_t slot);
+
+    /**
+     * @brief Remove a slot from the hash-cons, its arguments must not have changed since link
+     */
+    void unlink(uint32_t slot);
+
+    /**
+     * @brief Lexicographically compare the tuples stored in two slots
      *
-     * Assumes data is already sorted. Removes consecutive duplicate tuples
-     * where all arity elements (including e-class ID) are identical.
+     * @return negative, zero or positive like memcmp
      */
-    void deduplicate();
+    int compare(uint32_t lhs, uint32_t rhs, size_t ncolumns) const;
+
+    /**
+     * @brief Find another live slot with the same arguments in the hash-cons
+     *
+     * Tuples with only an e-class id column have no arguments to be congruent
+     * on, for them only exact duplicates count.
+     *
+     * @return The other slot, or NIL if there is none
+     */
+    uint32_t find_duplicate(uint32_t slot) const;
+
+    /**
+     * @brief Collect and re-canonicalize all slots affected by new merges
+     *
+     * Drains the unseen suffix of the union-find log through the uses index
+     * and takes all fresh slots. Affected slots are re-canonicalized in place,
+     * re-linked in the hash-cons and re-registered in the uses index.
+     *
+     * @return The affected slots, sorted by their canonical tuples
+     */
+    Vec<uint32_t> collect_affected(const Handle handle);
+
+    /**
+     * @brief Drop the affected slots which collide with another live slot
+     *
+     * Every live tuple is canonical at this point and, before the merges,
+     * no two live tuples had the same arguments. So each collision involves
+     * an affected slot and is found by probing the hash-cons with it. Of two
+     * colliding tuples the lexicographically larger one is dropped, if their
+     * e-class ids differ the pair of ids is appended to unions first.
+     */
+    void resolve_collisions(const Vec<uint32_t>& affected, Vec<std::pair<id_t, id_t>>& unions);
+
+    /**
+     * @brief Rewrite the slot buffer without its dead slots
+     *
+     * Only called once dead slots make up at least half of the buffer,
+     * which keeps the cost amortized constant per removed tuple.
+     */
+    void compact();
 
   public:
-    RowStore(Symbol symbol, size_t arity)
+    RowStore(Symbol symbol, size_t arity, bool commutative = false)
         : arity(arity)
         , symbol(symbol)
+        , commutative(commutative)
     {
+        assert(!commutative || arity == 3);
     }
 
     /**
@@ -39,20 +167,62 @@ class RowStore
      */
     size_t size() const
     {
-        return data.size() / arity;
+        return data.size() / arity - ndead;
     }
 
     /**
      * @brief Add a tuple to the relation
      *
+     * The tuple is appended as a fresh slot and checked for congruences
+     * on the next rebuild.
+     *
      * @param tuple The tuple to add, must have exactly 'arity' elements
-     * @throws std::invalid_argument if tuple size doesn't match relation arity
      */
     void add_tuple(const Vec<id_t>& tuple)
     {
         assert(tuple.size() == static_cast<size_t>(arity));
 
+        uint32_t slot = static_cast<uint32_t>(data.size() / arity);
+
+        fresh.push_back(slot);
         data.insert(data.end(), tuple.begin(), tuple.end());
+        sort_arguments(row(slot));
+
+        next.push_back(NIL);
+        link(slot);
+    }
+
+    /**
+     * @brief Find the e-class of the term with the given arguments
+     *
+     * Only finds tuples under the arguments they were stored or last
+     * canonicalized with, so args should be canonical and the relation
+     * rebuilt since the last union.
+     *
+     * @param args The arguments, without the e-class id column
+     * @return The e-class id of a live tuple with these arguments, if any
+     */
+    std::optional<id_t> lookup(const Vec<id_t>& args) const;
+
+    /**
+     * @brief Call f with a pointer to each live tuple, in slot order
+     */
+    template <typename F>
+    void for_each_tuple(F f) const
+    {
+        auto nslots = static_cast<uint32_t>(data.size() / arity);
+        for (uint32_t slot = 0; slot < nslots; ++slot)
+            if (!is_dead(slot))
+                f(row(slot));
+    }
+
+    /**
+     * @brief Call f(children, nchildren, eclass) for each live tuple
+     */
+    template <typename F>
+    void for_each_term(F f) const
+    {
+        for_each_tuple([&](const id_t *tuple) { f(tuple, arity - 1, tuple[arity - 1]); });
     }
 
     /**
@@ -65,20 +235,53 @@ class RowStore
         return symbol;
     }
 
+    /**
+     * @brief Build a trie over the live tuples, with the columns in the order of a permutation
+     *
+     * @param vo Permutation of the columns
+     */
+    std::shared_ptr<TrieNode> build_trie(uint32_t vo) const;
+
     AbstractIndex populate_index(uint32_t vo);
 
     /**
      * @brief Rebuild the relation by detecting and unifying duplicate entries
      *
-     * Sorts all tuples by their first (arity-1) attributes and detects neighboring
-     * tuples with identical arguments but different e-class IDs. When found, calls
-     * the unify_callback to merge the e-classes.
+     * Re-canonicalizes only the tuples which mention an id that was re-rooted
+     * since the last rebuild, plus all freshly added tuples, and looks each of
+     * them up in the hash-cons. Tuples with identical arguments but different
+     * e-class IDs get unified. Repeats until the relation has caught up with
+     * its own unifications.
      *
-     * @param unify_callback Function to call when two IDs need to be unified
+     * @param handle Handle to canonicalize and unify e-class ids
      * @return true if any unifications were performed, false otherwise
      */
     bool rebuild(Handle handle);
 
+    /**
+     * @brief Perform one round of rebuilding without unifying anything
+     *
+     * Like rebuild, but instead of calling unify the pairs of congruent
+     * e-class ids are appended to unions, and only a single round is done.
+     * The union-find is only read, so different relations can run this
+     * concurrently as long as nobody unifies in the meantime and the union
+     * log was synced after the last unification (see Handle::sync_union_log).
+     *
+     * @param handle Handle to canonicalize e-class ids
+     * @param unions Buffer receiving the pairs of ids which need to be unified
+     */
+    void collect_unions(const Handle handle, Vec<std::pair<id_t, id_t>>& unions);
+
+    /**
+     * @brief Estimate how much work the next rebuild has to do
+     *
+     * @return Number of fresh tuples plus unseen entries of the union log
+     */
+    size_t pending(const Handle handle) const
+    {
+        return fresh.size() + (handle.union_log().size() - log_cursor);
+    }
+
     /**
      * @brief Dump the relation contents to a file
      *
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+
 #include "types.h"
 #include "utils/multiset.h"
 
@@ -10,26 +12,29 @@ class MultisetSupport
 {
   private:
     const Multiset& mset;
+    // the unit of an ACU operator, implicitly present in every multiset
+    std::optional<id_t> unit;
 
   public:
-    explicit MultisetSupport(const Multiset& m)
+    explicit MultisetSupport(const Multiset& m, std::optional<id_t> unit = std::nullopt)
         : mset(m)
+        , unit(unit)
     {
     }
 
     bool contains(id_t id) const
     {
-        return mset.contains(id);
+        return mset.contains(id) || id == unit;
     }
 
     size_t size() const
     {
-        return mset.unique_size();
+        return mset.unique_size() + (unit.has_value() && !mset.contains(*unit) ? 1 : 0);
     }
 
     bool empty() const
     {
-        return mset.empty();
+        return mset.empty() && !unit.has_value();
     }
 
     template <typename Func>
@@ -38,6 +43,9 @@ class MultisetSupport
         for (const auto& [item, count] : mset.data)
             if (count > 0)
                 f(item);
+
+        if (unit.has_value() && !mset.contains(*unit))
+            f(*unit);
     }
 };
 
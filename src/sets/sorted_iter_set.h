@@ -20,6 +20,12 @@ class SortedIterSet
     {
     }
 
+    SortedIterSet(Vec<id_t>::const_iterator begin, Vec<id_t>::const_iterator end)
+        : begin(begin)
+        , end(end)
+    {
+    }
+
     bool contains(id_t id) const
     {
         auto it = std::lower_bound(begin, end, id);
@@ -1,3 +1,4 @@
+#include <functional>
 #include <memory>
 #include <stdexcept>
 
@@ -25,6 +26,13 @@ std::shared_ptr<Expr> Expr::make_variable(Symbol var_name)
     return std::shared_ptr<Expr>(new Expr(NodeKind::VARIABLE, var_name));
 }
 
+std::shared_ptr<Expr> Expr::make_rest_variable(Symbol var_name)
+{
+    auto expr = std::shared_ptr<Expr>(new Expr(NodeKind::VARIABLE, var_name));
+    expr->rest = true;
+    return expr;
+}
+
 std::shared_ptr<Expr> Expr::make_operator(Symbol op)
 {
     return std::shared_ptr<Expr>(new Expr(NodeKind::OPERATOR, op));
@@ -48,6 +56,20 @@ Symbol Theory::add_operator(Symbol symbol, int arity)
     return symbol;
 }
 
+Symbol Theory::add_operator(Symbol symbol, int arity, Symbol unit)
+{
+    if (arity != AC && arity != ACI)
+        throw std::invalid_argument("Only AC operators can have a unit: " + symbols.get_string(symbol));
+
+    if (has_operator(unit) && get_arity(unit) != 0)
+        throw std::invalid_argument("The unit of an operator must be nullary: " + symbols.get_string(unit));
+
+    operators[unit] = 0;
+    units[symbol] = unit;
+
+    return add_operator(symbol, arity);
+}
+
 Symbol Theory::add_opaque_operator(int arity)
 {
     Symbol symbol = symbols.create_opaque();
@@ -80,6 +102,32 @@ RewriteRule Theory::add_rewrite_rule(const std::string& name, std::shared_ptr<Ex
                                     "Non-linear patterns like (f ?x ?x) are not currently supported.");
     }
 
+    // Rest variables bind the remaining children of an AC operator,
+    // so each AC operator can have at most one of them as a direct child.
+    std::function<bool(const Expr *)> check_rest = [&](const Expr *expr) -> bool {
+        if (expr->is_variable())
+            return true;
+
+        size_t nrest = 0;
+        for (const auto& child : expr->children)
+            nrest += child->is_rest() ? 1 : 0;
+
+        if (nrest > 1 || (nrest == 1 && !is_ac(expr->symbol)))
+            return false;
+
+        for (const auto& child : expr->children)
+            if (!check_rest(child.get()))
+                return false;
+
+        return true;
+    };
+
+    if (lhs->is_rest() || !check_rest(lhs.get()))
+    {
+        throw std::invalid_argument("Misplaced rest variable in rule '" + name + "': " + lhs->to_sexpr(symbols) +
+                                    "\nRest variables must be direct children of an AC operator, at most one each.");
+    }
+
     RewriteRule rule(intern(name), lhs, rhs);
     rewrite_rules.push_back(rule);
     return rule;
@@ -96,7 +144,7 @@ RewriteRule Theory::add_rewrite_rule(const std::string& name, const std::string&
 std::string Expr::to_sexpr(const SymbolTable& symbols) const
 {
     if (is_variable())
-        return "?" + symbols.get_string(symbol);
+        return "?" + symbols.get_string(symbol) + (rest ? "..." : "");
 
     std::string result = "(" + symbols.get_string(symbol);
 
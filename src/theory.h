@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <string>
 
 #include "symbol_table.h"
@@ -12,6 +13,15 @@ namespace eqsat
 // #define AC -1
 constexpr auto AC = -1;
 
+// binary operators which are commutative but not associative
+constexpr auto C = -2;
+
+// operators which are associative but not commutative
+constexpr auto A = -3;
+
+// AC operators which are also idempotent, their children form a set
+constexpr auto ACI = -4;
+
 /**
  * @brief Enumeration for distinguishing between different kinds of expression nodes.
  */
@@ -44,6 +54,9 @@ class Expr
     Symbol symbol;
     Vec<std::shared_ptr<Expr>> children;
 
+    /** @brief Set for rest variables `?rest...` which bind all remaining children of an AC operator */
+    bool rest = false;
+
     /**
      * @brief Creates a pattern variable expression.
      * @param var Symbol identifier for the variable name
@@ -53,6 +66,15 @@ class Expr
      */
     static std::shared_ptr<Expr> make_variable(Symbol var);
 
+    /**
+     * @brief Creates a rest variable expression.
+     * @param var Symbol identifier for the variable name
+     * @return Shared pointer to the created variable expression
+     *
+     * Example: auto rest = Expression::make_rest_variable(symbols.intern("rest"));
+     */
+    static std::shared_ptr<Expr> make_rest_variable(Symbol var);
+
     /**
      * @brief Creates a nullary operator expression (no children).
      * @param op Symbol identifier for the operator name
@@ -81,6 +103,15 @@ class Expr
         return kind == NodeKind::VARIABLE;
     }
 
+    /**
+     * @brief Checks if this expression is a rest variable.
+     * @return true if this is a variable written as `?name...`, false otherwise
+     */
+    bool is_rest() const
+    {
+        return is_variable() && rest;
+    }
+
     /**
      * @brief Checks if this expression is an operator application.
      * @return true if this is an operator, false otherwise
@@ -146,6 +177,8 @@ class Theory
 
     // symbol --> arity
     HashMap<Symbol, int> operators;
+    // AC operator --> its unit, a nullary operator
+    HashMap<Symbol, Symbol> units;
     Vec<RewriteRule> rewrite_rules;
 
     Theory()
@@ -164,9 +197,38 @@ class Theory
 
     Symbol add_operator(Symbol symbol, int arity);
 
+    Symbol add_operator(const std::string& op, int arity, const std::string& unit)
+    {
+        return add_operator(intern(op), arity, intern(unit));
+    }
+
+    /**
+     * @brief Add an AC operator with a unit element (ACU)
+     *
+     * The unit is a nullary operator, registered as well if it is new. Terms
+     * of the operator never mention the unit: `op(x, unit)` is `op(x)` which is
+     * `x`, and `op()` is the unit. Patterns see the unit as implicitly present
+     * in every term, so rules like `(op ?x (unit)) -> ?x` are not needed.
+     *
+     * @param arity Must be AC or ACI
+     * @throws std::invalid_argument if arity is not AC or ACI, or the unit is not nullary
+     */
+    Symbol add_operator(Symbol symbol, int arity, Symbol unit);
+
+    /**
+     * @brief Get the unit of an ACU operator
+     * @return The unit's symbol, or nullopt if the operator has none
+     */
+    std::optional<Symbol> get_unit(Symbol symbol) const
+    {
+        auto it = units.find(symbol);
+        return it == units.end() ? std::nullopt : std::optional<Symbol>(it->second);
+    }
+
     /**
      * @brief Add an opaque operator with the given arity.
-     * @param arity The arity of the operator (use AC for associative-commutative)
+     * @param arity The arity of the operator (use AC for associative-commutative,
+     *              ACI for idempotent AC, C for binary commutative, A for associative)
      * @return Symbol identifier for the opaque operator
      *
      * Opaque operators have unique IDs but return "<opaque>" when converted to string.
@@ -177,6 +239,45 @@ class Theory
     bool has_operator(Symbol symbol) const;
     int get_arity(Symbol symbol) const;
 
+    /**
+     * @brief Check whether the order of the children of an operator is irrelevant
+     * @return true for AC, ACI and C operators, false otherwise
+     */
+    bool is_commutative(Symbol symbol) const
+    {
+        int arity = get_arity(symbol);
+        return arity == AC || arity == ACI || arity == C;
+    }
+
+    /**
+     * @brief Check whether the terms of an operator are stored flattened
+     * @return true for AC, ACI and A operators, false otherwise
+     */
+    bool is_associative(Symbol symbol) const
+    {
+        int arity = get_arity(symbol);
+        return arity == AC || arity == ACI || arity == A;
+    }
+
+    /**
+     * @brief Check whether the terms of an operator are stored in an AC relation
+     * @return true for AC and ACI operators, false otherwise
+     */
+    bool is_ac(Symbol symbol) const
+    {
+        int arity = get_arity(symbol);
+        return arity == AC || arity == ACI;
+    }
+
+    /**
+     * @brief Check whether repeated children of an operator are redundant
+     * @return true for ACI operators, false otherwise
+     */
+    bool is_idempotent(Symbol symbol) const
+    {
+        return get_arity(symbol) == ACI;
+    }
+
     RewriteRule add_rewrite_rule(const std::string& name, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs);
     RewriteRule add_rewrite_rule(const std::string& name, const std::string& lhs_str, const std::string& rhs_str);
 };
@@ -1,6 +1,6 @@
 /// Implementation of the union-find data structure
-/// It does perform path splitting but not union-by-{rank,size}
-/// when unifying two sets it chooses the one with the smaller id.
+/// It does perform path halving, also on the const path, and depending
+/// on the policy unifies by size or keeps the smaller id as the root.
 
 #include <algorithm>
 #include <fstream>
@@ -10,7 +10,8 @@
 namespace eqsat
 {
 
-UnionFind::UnionFind()
+UnionFind::UnionFind(UnionPolicy policy)
+    : policy(policy)
 {
 }
 
@@ -19,15 +20,20 @@ id_t UnionFind::make_set()
     ++nclasses;
     id_t x = static_cast<id_t>(vec.size());
     vec.push_back(x);
+    sizes.push_back(1);
     return x;
 }
 
-id_t UnionFind::_find_root_ph(id_t x)
+id_t UnionFind::_find_root_ph(id_t x) const noexcept
 {
-    while (vec[x] != x)
+    id_t parent = vec[x].load();
+    while (parent != x)
     {
-        vec[x] = vec[vec[x]];
-        x = vec[x];
+        id_t grandparent = vec[parent].load();
+        vec[x].store(grandparent);
+
+        x = grandparent;
+        parent = vec[x].load();
     }
 
     return x;
@@ -41,10 +47,14 @@ id_t UnionFind::unify(id_t a, id_t b)
     if (root_a == root_b)
         return root_a;
 
-    if (root_a > root_b)
+    // the root of the larger class stays, ties keep the smaller id
+    bool by_size = policy == UnionPolicy::BySize && sizes[root_a] != sizes[root_b];
+    if (by_size ? sizes[root_a] < sizes[root_b] : root_a > root_b)
         std::swap(root_a, root_b);
 
-    vec[root_b] = root_a;
+    vec[root_b].store(root_a);
+    sizes[root_a] += sizes[root_b];
+    log.push_back(root_b);
 
     nclasses--;
     return root_a;
@@ -52,30 +62,29 @@ id_t UnionFind::unify(id_t a, id_t b)
 
 void UnionFind::normalize()
 {
+    // a parent which was visited before points at its root already,
+    // with lowest-id roots that holds for every parent
     for (size_t i = 0; i < vec.size(); ++i)
-        vec[i] = vec[vec[i]];
+        vec[i].store(find_root(static_cast<id_t>(i)));
 }
 
-void UnionFind::dump_to_file(std::ofstream& out) const
+void dump_classes(std::ofstream& out, const Vec<id_t>& roots)
 {
     out << "====<< Union-Find >>====\n\n";
 
     // root --> members
     HashMap<id_t, Vec<id_t>> classes;
 
-    for (size_t i = 0; i < vec.size(); ++i)
-    {
-        id_t root = find_root(static_cast<id_t>(i));
-        classes[root].push_back(static_cast<id_t>(i));
-    }
+    for (size_t i = 0; i < roots.size(); ++i)
+        classes[roots[i]].push_back(static_cast<id_t>(i));
 
-    Vec<id_t> roots;
-    roots.reserve(classes.size());
+    Vec<id_t> sorted;
+    sorted.reserve(classes.size());
     for (const auto& [root, _] : classes)
-        roots.push_back(root);
-    std::sort(roots.begin(), roots.end());
+        sorted.push_back(root);
+    std::sort(sorted.begin(), sorted.end());
 
-    for (id_t root : roots)
+    for (id_t root : sorted)
     {
         const auto& members = classes[root];
         out << "  {";
@@ -90,4 +99,13 @@ void UnionFind::dump_to_file(std::ofstream& out) const
     out << "\n";
 }
 
+void UnionFind::dump_to_file(std::ofstream& out) const
+{
+    Vec<id_t> roots(vec.size());
+    for (size_t i = 0; i < vec.size(); ++i)
+        roots[i] = find_root(static_cast<id_t>(i));
+
+    dump_classes(out, roots);
+}
+
 } // namespace eqsat
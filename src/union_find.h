@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <fstream>
 
 #include "types.h"
@@ -7,16 +8,84 @@
 namespace eqsat
 {
 
+/**
+ * @brief How unify picks the root of the merged class
+ */
+enum class UnionPolicy
+{
+    // the smaller id stays canonical, so canonical ids never change their order
+    LowestId,
+    // the root of the larger class stays canonical, which keeps the trees shallow
+    BySize,
+};
+
+/**
+ * @brief Id slot which several threads may read and write concurrently
+ *
+ * Copyable, so it can live in a Vec which is only resized while no other
+ * thread accesses it. Loads and stores are relaxed, which suffices for the
+ * parent pointers of a union-find: a find only ever replaces a parent by one
+ * of its ancestors, so racing finds can overwrite each other in any order
+ * without breaking a path.
+ */
+struct AtomicId
+{
+    mutable std::atomic<id_t> id;
+
+    AtomicId(id_t id)
+        : id(id)
+    {
+    }
+
+    AtomicId(const AtomicId& other)
+        : id(other.load())
+    {
+    }
+
+    AtomicId& operator=(const AtomicId& other)
+    {
+        store(other.load());
+        return *this;
+    }
+
+    id_t load() const noexcept
+    {
+        return id.load(std::memory_order_relaxed);
+    }
+
+    void store(id_t x) const noexcept
+    {
+        id.store(x, std::memory_order_relaxed);
+    }
+
+    bool compare_exchange(id_t expected, id_t desired) const noexcept
+    {
+        return id.compare_exchange_strong(expected, desired, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @brief Print the equivalence classes, given the root of every id
+ */
+void dump_classes(std::ofstream& out, const Vec<id_t>& roots);
+
 class UnionFind
 {
   private:
-    Vec<id_t> vec;
+    Vec<AtomicId> vec;
+    // root --> number of ids in its class, only meaningful for roots
+    Vec<uint32_t> sizes;
     size_t nclasses = 0;
+    UnionPolicy policy;
+
+    // ids which stopped being a root, in the order they were unified.
+    // Every id enters the log at most once, so it never outgrows vec.
+    Vec<id_t> log;
 
-    id_t _find_root_ph(id_t x);
+    id_t _find_root_ph(id_t x) const noexcept;
 
   public:
-    UnionFind();
+    UnionFind(UnionPolicy policy = UnionPolicy::LowestId);
     ~UnionFind() = default;
 
     UnionFind(const UnionFind&) = delete;
@@ -30,26 +99,44 @@ class UnionFind
         return nclasses;
     }
 
+    /**
+     * @brief Change how future unifications pick their root, existing classes keep theirs
+     */
+    void set_policy(UnionPolicy new_policy)
+    {
+        policy = new_policy;
+    }
+
     id_t make_set();
     id_t unify(id_t a, id_t b);
 
     inline id_t find_root_mut(id_t x) noexcept
+    {
+        return find_root(x);
+    }
+
+    /**
+     * @brief Find the canonical id of x, halving the path on the way
+     *
+     * Safe to call from several threads at once as long as nobody unifies.
+     */
+    inline id_t find_root(id_t x) const noexcept
     {
         // quick check which helps the branch predictor
         // since most of our ids are already canonical
-        if (vec[x] == x)
+        if (vec[x].load() == x)
             return x;
 
         // iterative version with path halving
         return _find_root_ph(x);
     }
 
-    inline id_t find_root(id_t x) const noexcept
+    /**
+     * @brief Get the parent slot of x as is, without following it to the root
+     */
+    id_t parent(id_t x) const noexcept
     {
-        while (vec[x] != x)
-            x = vec[x];
-
-        return x;
+        return vec[x].load();
     }
 
     inline bool same(id_t a, id_t b) const noexcept
@@ -62,6 +149,33 @@ class UnionFind
         return vec.size();
     }
 
+    /**
+     * @brief Get the log of ids which were re-rooted by unify
+     *
+     * The log is append-only. Consumers which want to react to merges
+     * incrementally remember how far they have read and only look at
+     * the suffix which was appended since.
+     *
+     * @return All ids which are no longer canonical, in unification order
+     */
+    const Vec<id_t>& union_log() const noexcept
+    {
+        return log;
+    }
+
+    /**
+     * @brief Nothing to do, unify appends to the log itself, see ConcurrentUnionFind::sync_log
+     */
+    void sync_log() noexcept
+    {
+    }
+
+    /**
+     * @brief Point every id directly at its root
+     *
+     * Afterwards each find takes at most one step, worth it right before
+     * a phase which canonicalizes a lot, like building the indices.
+     */
     void normalize();
 
     /**
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <functional>
 #include <utility>
 
@@ -93,7 +94,7 @@ class Multiset
     /**
      * @brief Constructs the multiset from a range of elements.
      *
-     * Counts occurrences of each unique element in the range and stores them in sorted order.
+     * Sorts a copy of the range and run-length encodes it into (value, count) pairs.
      * Called by the constructors to initialize the multiset.
      *
      * @param begin Iterator to the start of the range
@@ -101,17 +102,17 @@ class Multiset
      */
     void construct(Vec<id_t>::const_iterator begin, Vec<id_t>::const_iterator end)
     {
-        data.reserve(end - begin);
+        Vec<id_t> sorted(begin, end);
+        std::sort(sorted.begin(), sorted.end());
 
-        for (; begin < end; ++begin)
+        for (size_t i = 0; i < sorted.size();)
         {
-            auto id = *begin;
-            auto it = find_pos(id);
+            size_t j = i + 1;
+            while (j < sorted.size() && sorted[j] == sorted[i])
+                ++j;
 
-            if (it != data.end() && it->first == id)
-                ++it->second;
-            else
-                data.insert(it, {id, 1});
+            data.push_back({sorted[i], static_cast<uint32_t>(j - i)});
+            i = j;
         }
 
         data.shrink_to_fit();
@@ -119,6 +120,31 @@ class Multiset
         rehash();
     }
 
+    /**
+     * @brief Finds the first entry not less than id in a sorted range by exponential search.
+     *
+     * Costs O(log d) where d is the distance to the result, which beats a linear scan
+     * when one multiset is much larger than the other.
+     */
+    template <typename It>
+    static It gallop(It first, It last, id_t id)
+    {
+        size_t step = 1;
+        It lo = first;
+
+        while (static_cast<size_t>(last - lo) > step && (lo + step)->first < id)
+        {
+            lo += step;
+            step *= 2;
+        }
+
+        It hi = static_cast<size_t>(last - lo) > step ? lo + step + 1 : last;
+        return std::lower_bound(lo, hi, id, cmp);
+    }
+
+    // beyond this size ratio the merges gallop through the larger multiset
+    static constexpr size_t GALLOP_RATIO = 16;
+
     /**
      * @brief Recomputes the fingerprint hash from scratch.
      *
@@ -199,22 +225,81 @@ class Multiset
         if (this->size() != other.size())
             return false;
 
-        for (const auto& [value, count] : this->data)
-            if (other.count(value) != count)
-                return false;
+        // single merge over both entry lists, skipping zero-count entries
+        auto lhs = data.begin(), rhs = other.data.begin();
+        while (true)
+        {
+            while (lhs != data.end() && lhs->second == 0)
+                ++lhs;
+            while (rhs != other.data.end() && rhs->second == 0)
+                ++rhs;
 
-        for (const auto& [value, count] : other.data)
-            if (this->count(value) != count)
+            if (lhs == data.end() || rhs == other.data.end())
+                return lhs == data.end() && rhs == other.data.end();
+
+            if (*lhs != *rhs)
                 return false;
 
-        return true;
+            ++lhs;
+            ++rhs;
+        }
+    }
+
+    /**
+     * @brief Orders multisets by size first and then lexicographically by their entries.
+     *
+     * The (element, count) entries are compared pairwise, zero-count entries are skipped.
+     * Among multisets of equal size the one with the smaller minimum element comes first.
+     *
+     * @param other The multiset to compare against
+     * @return true if this multiset comes before 'other', false otherwise
+     */
+    [[nodiscard]] bool operator<(const Multiset& other) const
+    {
+        if (this->size() != other.size())
+            return this->size() < other.size();
+
+        auto lhs = data.begin(), rhs = other.data.begin();
+        while (true)
+        {
+            while (lhs != data.end() && lhs->second == 0)
+                ++lhs;
+            while (rhs != other.data.end() && rhs->second == 0)
+                ++rhs;
+
+            if (lhs == data.end() || rhs == other.data.end())
+                return lhs == data.end() && rhs != other.data.end();
+
+            if (*lhs != *rhs)
+                return *lhs < *rhs;
+
+            ++lhs;
+            ++rhs;
+        }
+    }
+
+    /**
+     * @brief Returns the smallest element with non-zero count.
+     *
+     * @pre The multiset is not empty
+     */
+    [[nodiscard]] id_t min() const
+    {
+        assert(nelements > 0);
+
+        auto it = data.begin();
+        while (it->second == 0)
+            ++it;
+
+        return it->first;
     }
 
     /**
      * @brief Checks if this multiset includes another as a submultiset.
      *
      * Returns true if for every element in 'other', this multiset contains at least as many
-     * occurrences of that element.
+     * occurrences of that element. Both sorted entry lists are walked in a single linear merge,
+     * which gallops through this multiset if it is much larger than 'other'.
      *
      * @param other The potential submultiset to check
      * @return true if 'other' is a submultiset of this multiset, false otherwise
@@ -224,9 +309,23 @@ class Multiset
         if (other.nelements > this->nelements)
             return false;
 
+        bool skewed = data.size() > GALLOP_RATIO * other.data.size();
+
+        auto it = data.begin();
         for (const auto& [value, count] : other.data)
-            if (this->count(value) < count)
+        {
+            if (count == 0)
+                continue;
+
+            if (skewed)
+                it = gallop(it, data.end(), value);
+            else
+                while (it != data.end() && it->first < value)
+                    ++it;
+
+            if (it == data.end() || it->first != value || it->second < count)
                 return false;
+        }
 
         return true;
     }
@@ -291,6 +390,59 @@ class Multiset
         }
     }
 
+    /**
+     * @brief Removes all occurrences of an element from the multiset.
+     *
+     * Unlike remove, the entry of the element is dropped as well.
+     *
+     * @param id The element to erase
+     * @return The number of occurrences removed
+     */
+    uint32_t erase(id_t id)
+    {
+        auto it = find_pos(id);
+        if (it == data.end() || it->first != id)
+            return 0;
+
+        uint32_t count = it->second;
+        data.erase(it);
+        nelements -= count;
+
+        rehash();
+        return count;
+    }
+
+    /**
+     * @brief Reduces the count of every element to one, turning the multiset into a set.
+     *
+     * Zero-count entries are dropped as well.
+     *
+     * @return true if any count changed, false otherwise
+     */
+    bool dedup()
+    {
+        bool changed = false;
+
+        size_t j = 0;
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            if (data[i].second == 0)
+                continue;
+
+            changed |= data[i].second != 1;
+            data[j++] = {data[i].first, 1};
+        }
+
+        changed |= j != data.size();
+        data.resize(j);
+        nelements = j;
+
+        if (changed)
+            rehash();
+
+        return changed;
+    }
+
     /**
      * @brief Checks if an element is present in the multiset with non-zero count.
      *
@@ -426,6 +578,8 @@ class Multiset
      *
      * Returns a new multiset containing elements from this multiset with their counts reduced
      * by the counts in 'other'. Elements with zero or negative difference are omitted.
+     * Computed by a single merge over both entry lists, galloping through 'other' if it is
+     * much larger than this multiset.
      *
      * @param other The multiset to subtract
      * @return A new multiset representing this \ other
@@ -433,23 +587,64 @@ class Multiset
     [[nodiscard]] Multiset msetdiff(const Multiset& other) const
     {
         Multiset diff;
+        diff.data.reserve(data.size());
+
+        bool skewed = other.data.size() > GALLOP_RATIO * data.size();
 
+        auto it = other.data.begin();
         for (const auto& [value, count] : data)
         {
-            uint32_t other_count = other.count(value);
+            if (skewed)
+                it = gallop(it, other.data.end(), value);
+            else
+                while (it != other.data.end() && it->first < value)
+                    ++it;
+
+            uint32_t other_count = (it != other.data.end() && it->first == value) ? it->second : 0;
             if (count > other_count)
             {
-                diff.insert(value, count - other_count);
+                diff.data.push_back({value, count - other_count});
+                diff.nelements += count - other_count;
+                diff.fingerprint.insert(value, count - other_count);
             }
         }
 
         return diff;
     }
 
+    /**
+     * @brief Inserts all elements of another multiset, adding up the counts.
+     *
+     * Both entry lists are merged into a fresh buffer in one linear pass. The hash is
+     * updated incrementally with the entries of 'other'.
+     *
+     * @param other The multiset whose elements are added
+     */
     void insert_all(const Multiset& other)
     {
+        Vec<std::pair<id_t, uint32_t>> merged;
+        merged.reserve(data.size() + other.data.size());
+
+        auto lhs = data.begin();
         for (const auto& [value, count] : other.data)
-            insert(value, count);
+        {
+            if (count == 0)
+                continue;
+
+            while (lhs != data.end() && lhs->first < value)
+                merged.push_back(*lhs++);
+
+            if (lhs != data.end() && lhs->first == value)
+                merged.push_back({value, (lhs++)->second + count});
+            else
+                merged.push_back({value, count});
+
+            nelements += count;
+            fingerprint.insert(value, count);
+        }
+
+        merged.insert(merged.end(), lhs, data.end());
+        data = std::move(merged);
     }
 
     /**
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cassert>
+#include <utility>
+
+#include "types.h"
+#include "utils/multiset.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Compact handle of a multiset interned in a MultisetStore
+ */
+using mset_id_t = uint32_t;
+
+/**
+ * @brief Hash-consing arena for multisets
+ *
+ * Every distinct multiset is stored exactly once and identified by its position
+ * in the arena. Two multisets of the same store are equal if and only if their
+ * ids are equal, so relations and indices can hold and compare plain integers
+ * instead of owning copies of the multisets.
+ *
+ * Lookup goes through the multiset fingerprint. Multisets sharing a fingerprint
+ * are chained and compared in full, so collisions never merge distinct multisets.
+ *
+ * Ids stay valid until the multiset is swept. Canonicalization keeps replacing
+ * multisets by new ones, so the owners of the ids periodically mark the ones
+ * they still use and sweep the rest (see Database::rebuild). Swept ids are
+ * handed out again by intern(). References returned by get() are invalidated
+ * by the next call to intern().
+ */
+class MultisetStore
+{
+  public:
+    static constexpr mset_id_t NONE = ~static_cast<mset_id_t>(0);
+
+  private:
+    Vec<Multiset> msets;
+
+    // fingerprint --> most recently interned multiset with that fingerprint
+    HashMap<uint64_t, mset_id_t> heads;
+    // multiset id --> next multiset id in the same chain
+    Vec<mset_id_t> next;
+    // swept ids, reused before the arena grows
+    Vec<mset_id_t> free;
+
+  public:
+    MultisetStore() = default;
+
+    /**
+     * @brief Look up the id of a multiset without interning it
+     *
+     * @return The id of an equal multiset, or NONE if there is none
+     */
+    mset_id_t find(const Multiset& mset) const
+    {
+        auto it = heads.find(mset.hash());
+        if (it == heads.end())
+            return NONE;
+
+        for (mset_id_t id = it->second; id != NONE; id = next[id])
+            if (msets[id] == mset)
+                return id;
+
+        return NONE;
+    }
+
+    /**
+     * @brief Get the id of a multiset, storing it first if it is new
+     */
+    mset_id_t intern(Multiset mset)
+    {
+        mset_id_t id = find(mset);
+        if (id != NONE)
+            return id;
+
+        if (free.empty())
+        {
+            id = static_cast<mset_id_t>(msets.size());
+            msets.emplace_back();
+            next.push_back(NONE);
+        }
+        else
+        {
+            id = free.back();
+            free.pop_back();
+        }
+
+        auto [it, inserted] = heads.try_emplace(mset.hash(), id);
+        next[id] = inserted ? NONE : it->second;
+        it->second = id;
+
+        msets[id] = std::move(mset);
+        return id;
+    }
+
+    /**
+     * @brief Drop every multiset whose id is not marked, its id may be reused
+     *
+     * Takes time linear in the number of ids handed out so far.
+     *
+     * @param live One flag per id below capacity(), true for the ids still in use
+     */
+    void sweep(const Vec<bool>& live)
+    {
+        assert(live.size() == msets.size());
+
+        heads.clear();
+        free.clear();
+
+        for (auto id = static_cast<mset_id_t>(msets.size()); id-- > 0;)
+        {
+            if (!live[id])
+            {
+                // moving out releases the buffer, assigning alone might keep it
+                Multiset released = std::move(msets[id]);
+                msets[id] = Multiset();
+                free.push_back(id);
+                continue;
+            }
+
+            auto [it, inserted] = heads.try_emplace(msets[id].hash(), id);
+            next[id] = inserted ? NONE : it->second;
+            it->second = id;
+        }
+    }
+
+    const Multiset& get(mset_id_t id) const
+    {
+        return msets[id];
+    }
+
+    /**
+     * @brief Get the number of distinct multisets stored
+     */
+    size_t size() const
+    {
+        return msets.size() - free.size();
+    }
+
+    /**
+     * @brief Get one past the largest id handed out so far
+     */
+    size_t capacity() const
+    {
+        return msets.size();
+    }
+};
+
+} // namespace eqsat
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include "types.h"
+
+namespace eqsat
+{
+
+/**
+ * @brief Call f(i) for every i in [0, n) on up to nthreads threads
+ *
+ * The calling thread takes part, and indices are handed out one at a time,
+ * so uneven work items balance out. Runs serially for nthreads <= 1.
+ */
+template <typename F>
+void parallel_for(size_t n, size_t nthreads, F f)
+{
+    nthreads = std::min(nthreads, n);
+
+    if (nthreads <= 1)
+    {
+        for (size_t i = 0; i < n; ++i)
+            f(i);
+
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1))
+            f(i);
+    };
+
+    Vec<std::thread> threads;
+    threads.reserve(nthreads - 1);
+    for (size_t t = 1; t < nthreads; ++t)
+        threads.emplace_back(worker);
+
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+} // namespace eqsat
@@ -0,0 +1,188 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "egraph.h"
+#include "theory.h"
+
+using namespace eqsat;
+
+// These tests verify associative (A) operator behavior: terms are
+// flattened, so parenthesization is irrelevant, but the order of
+// the children is kept and patterns match contiguous windows.
+
+TEST_CASE("A operators identify all parenthesizations", "[egraph][a][rebuild]")
+{
+    Theory theory;
+
+    theory.add_operator("a", 0);
+    theory.add_operator("b", 0);
+    theory.add_operator("c", 0);
+    theory.add_operator("comp", A);
+
+    EGraph egraph(theory);
+
+    id_t left = egraph.add_expr("(comp (comp (a) (b)) (c))");
+    id_t right = egraph.add_expr("(comp (a) (comp (b) (c)))");
+    id_t swapped = egraph.add_expr("(comp (comp (b) (a)) (c))");
+
+    REQUIRE_FALSE(egraph.is_equiv(left, right));
+
+    egraph.rebuild();
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(left, right));
+    REQUIRE_FALSE(egraph.is_equiv(left, swapped));
+}
+
+TEST_CASE("A operators match contiguous windows in order", "[egraph][a][pattern]")
+{
+    Theory theory;
+
+    theory.add_operator("a", 0);
+    theory.add_operator("b", 0);
+    theory.add_operator("f", 0);
+    theory.add_operator("g", 0);
+    theory.add_operator("h", 0);
+    theory.add_operator("comp", A);
+
+    theory.add_rewrite_rule("fuse", "(comp (f) (g))", "(h)");
+
+    EGraph egraph(theory);
+
+    SECTION("Window inside a longer sequence")
+    {
+        id_t term = egraph.add_expr("(comp (comp (a) (f)) (comp (g) (b)))");
+
+        egraph.saturate(3);
+
+        id_t fused = egraph.add_expr("(comp (a) (h) (b))");
+        egraph.rebuild();
+
+        REQUIRE(egraph.is_equiv(term, fused));
+    }
+
+    SECTION("Reversed children do not match")
+    {
+        id_t term = egraph.add_expr("(comp (g) (f))");
+        id_t h = egraph.add_expr("(h)");
+
+        egraph.saturate(2);
+
+        REQUIRE_FALSE(egraph.is_equiv(term, h));
+    }
+
+    SECTION("Separated children do not match")
+    {
+        egraph.add_expr("(comp (f) (a) (g))");
+        id_t h = egraph.add_expr("(h)");
+        id_t fg = egraph.add_expr("(comp (f) (g))");
+        id_t fag = egraph.add_expr("(comp (f) (a) (g))");
+
+        egraph.saturate(2);
+
+        REQUIRE(egraph.is_equiv(fg, h));
+        REQUIRE_FALSE(egraph.is_equiv(fag, h));
+    }
+}
+
+TEST_CASE("A flattening respects growth limits", "[egraph][a][limits]")
+{
+    Theory theory;
+
+    theory.add_operator("a", 0);
+    theory.add_operator("b", 0);
+    theory.add_operator("c", 0);
+    theory.add_operator("comp", A);
+
+    auto run = [&](const ACLimits& limits) {
+        EGraph egraph(theory);
+        egraph.set_ac_limits(limits);
+
+        // comp(comp(a, b), c) vs comp(a, comp(b, c)), which only meet in comp(a, b, c)
+        id_t left = egraph.add_expr("(comp (comp (a) (b)) (c))");
+        id_t right = egraph.add_expr("(comp (a) (comp (b) (c)))");
+
+        for (int i = 0; i < 3; ++i)
+            egraph.rebuild();
+
+        return std::make_pair(egraph.is_equiv(left, right), egraph.ac_limit_counters());
+    };
+
+    SECTION("Unbounded by default")
+    {
+        auto [equiv, counters] = run(ACLimits{});
+
+        REQUIRE(equiv);
+        REQUIRE(counters.derived == 0);
+        REQUIRE(counters.size == 0);
+        REQUIRE(counters.depth == 0);
+    }
+
+    SECTION("Depth")
+    {
+        ACLimits limits;
+        limits.max_depth = 0;
+
+        auto [equiv, counters] = run(limits);
+
+        REQUIRE_FALSE(equiv);
+        REQUIRE(counters.depth > 0);
+    }
+
+    SECTION("Size")
+    {
+        ACLimits limits;
+        limits.max_size = 2;
+
+        auto [equiv, counters] = run(limits);
+
+        REQUIRE_FALSE(equiv);
+        REQUIRE(counters.size > 0);
+    }
+
+    SECTION("Derived tuples per rebuild")
+    {
+        ACLimits limits;
+        limits.max_derived = 0;
+
+        auto [equiv, counters] = run(limits);
+
+        REQUIRE_FALSE(equiv);
+        REQUIRE(counters.derived > 0);
+    }
+}
+
+TEST_CASE("A congruence drops tuples which became equal", "[egraph][a][rebuild]")
+{
+    Theory theory;
+
+    theory.add_operator("a", 0);
+    theory.add_operator("b", 0);
+    theory.add_operator("c", 0);
+    auto comp = theory.add_operator("comp", A);
+
+    EGraph egraph(theory);
+
+    id_t ac = egraph.add_expr("(comp (a) (c))");
+    id_t bc = egraph.add_expr("(comp (b) (c))");
+
+    auto count = [&]() {
+        size_t n = 0;
+        egraph.for_each_term([&](Symbol op, const id_t *, size_t, id_t) { n += op == comp; });
+        return n;
+    };
+
+    REQUIRE(count() == 2);
+
+    egraph.unify(egraph.add_expr("(a)"), egraph.add_expr("(b)"));
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(ac, bc));
+    REQUIRE(count() == 1);
+
+    // the surviving tuple still takes part in flattening
+    id_t nested = egraph.add_expr("(comp (comp (b) (c)) (b))");
+    id_t flat = egraph.add_expr("(comp (a) (c) (a))");
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(nested, flat));
+}
@@ -69,6 +69,349 @@ TEST_CASE("AC operators with deeply nested structures", "[egraph][ac][nested]")
     }
 }
 
+TEST_CASE("AC patterns nested in AC patterns", "[egraph][ac][nested]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto d = theory.add_operator("d", 0);
+    auto add = theory.add_operator("add", AC);
+    auto mul = theory.add_operator("mul", AC);
+
+    theory.add_rewrite_rule("factor", "(add (mul ?x ?y) (mul ?x ?z))", "(mul ?x (add ?y ?z))");
+
+    auto a_expr = Expr::make_operator(a);
+    auto b_expr = Expr::make_operator(b);
+    auto c_expr = Expr::make_operator(c);
+    auto d_expr = Expr::make_operator(d);
+
+    SECTION("Inner terms are taken from the children of the outer term")
+    {
+        EGraph egraph(theory);
+
+        // add(mul(a, b), mul(a, c), d) next to unrelated products
+        id_t sum = egraph.add_expr(Expr::make_operator(
+            add, {Expr::make_operator(mul, {a_expr, b_expr}), Expr::make_operator(mul, {a_expr, c_expr}), d_expr}));
+        egraph.add_expr(Expr::make_operator(mul, {b_expr, c_expr}));
+        egraph.add_expr(Expr::make_operator(mul, {a_expr, d_expr}));
+
+        id_t factored = egraph.add_expr(
+            Expr::make_operator(add, {Expr::make_operator(mul, {a_expr, Expr::make_operator(add, {b_expr, c_expr})}),
+                                      d_expr}));
+
+        egraph.saturate(2);
+
+        REQUIRE(egraph.is_equiv(sum, factored));
+    }
+
+    SECTION("Larger inner terms only match once flattening provides the exact product")
+    {
+        EGraph egraph(theory);
+
+        // add(mul(a, b, d), mul(a, c)) needs mul(b, d) to exist
+        id_t sum = egraph.add_expr(Expr::make_operator(
+            add, {Expr::make_operator(mul, {a_expr, b_expr, d_expr}), Expr::make_operator(mul, {a_expr, c_expr})}));
+
+        auto bd = Expr::make_operator(mul, {b_expr, d_expr});
+        id_t factored = egraph.add_expr(
+            Expr::make_operator(mul, {a_expr, Expr::make_operator(add, {bd, c_expr})}));
+
+        egraph.saturate(3);
+
+        REQUIRE(egraph.is_equiv(sum, factored));
+    }
+}
+
+TEST_CASE("AC rebuild flattens long nested chains", "[egraph][ac][nested]")
+{
+    Theory theory;
+
+    auto mul = theory.add_operator("mul", AC);
+
+    Vec<Symbol> leaves;
+    for (int i = 0; i < 16; ++i)
+        leaves.push_back(theory.add_operator("x" + std::to_string(i), 0));
+
+    EGraph egraph(theory);
+
+    // mul(mul(...mul(x0, x1)..., x14), x15)
+    auto nested = Expr::make_operator(mul, {Expr::make_operator(leaves[0]), Expr::make_operator(leaves[1])});
+    for (size_t i = 2; i < leaves.size(); ++i)
+        nested = Expr::make_operator(mul, {nested, Expr::make_operator(leaves[i])});
+
+    Vec<std::shared_ptr<Expr>> children;
+    for (auto leaf : leaves)
+        children.push_back(Expr::make_operator(leaf));
+    auto flat = Expr::make_operator(mul, children);
+
+    id_t nested_id = egraph.add_expr(nested);
+    id_t flat_id = egraph.add_expr(flat);
+
+    REQUIRE(egraph.is_equiv(nested_id, flat_id) == false);
+
+    // no rules needed, every rebuild flattens one more level
+    for (size_t i = 0; i < leaves.size(); ++i)
+        egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(nested_id, flat_id) == true);
+}
+
+TEST_CASE("AC operators with lazy flattening", "[egraph][ac][nested][lazy]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    theory.add_operator("d", 0);
+    auto mul = theory.add_operator("mul", AC);
+
+    auto a_expr = Expr::make_operator(a);
+    auto b_expr = Expr::make_operator(b);
+    auto c_expr = Expr::make_operator(c);
+
+    SECTION("Nestings of the same product are equivalent")
+    {
+        EGraph egraph(theory);
+        egraph.set_lazy_flattening(true);
+
+        // mul(mul(a, b), c) vs mul(a, mul(b, c))
+        id_t left = egraph.add_expr(Expr::make_operator(mul, {Expr::make_operator(mul, {a_expr, b_expr}), c_expr}));
+        id_t right = egraph.add_expr(Expr::make_operator(mul, {a_expr, Expr::make_operator(mul, {b_expr, c_expr})}));
+
+        egraph.rebuild();
+
+        REQUIRE(egraph.is_equiv(left, right));
+    }
+
+    SECTION("Patterns match the flattened term")
+    {
+        theory.add_rewrite_rule("abc", "(mul (a) (b) (c))", "(d)");
+
+        EGraph egraph(theory);
+        egraph.set_lazy_flattening(true);
+
+        id_t nested = egraph.add_expr(Expr::make_operator(mul, {Expr::make_operator(mul, {a_expr, b_expr}), c_expr}));
+        id_t d_id = egraph.add_expr("(d)");
+
+        egraph.saturate(2);
+
+        REQUIRE(egraph.is_equiv(nested, d_id));
+    }
+
+    SECTION("Cyclic e-classes are flattened in finite time")
+    {
+        EGraph egraph(theory);
+        egraph.set_lazy_flattening(true);
+
+        id_t a_id = egraph.add_expr(a_expr);
+        id_t m1 = egraph.add_expr(Expr::make_operator(mul, {a_expr, b_expr}));
+        id_t m2 = egraph.add_expr(Expr::make_operator(mul, {Expr::make_operator(mul, {a_expr, b_expr}), c_expr}));
+        egraph.rebuild();
+
+        // a = mul(mul(a, b), c) contains itself through mul(a, b)
+        egraph.unify(m2, a_id);
+        egraph.rebuild();
+        egraph.rebuild();
+
+        REQUIRE(egraph.is_equiv(m2, a_id));
+        REQUIRE_FALSE(egraph.is_equiv(m1, a_id));
+        REQUIRE(egraph.ac_limit_counters().lazy == 0);
+    }
+
+    SECTION("Bounded lazy flattening counts the truncations")
+    {
+        ACLimits limits;
+        limits.max_lazy = 0;
+
+        EGraph egraph(theory);
+        egraph.set_lazy_flattening(true);
+        egraph.set_ac_limits(limits);
+
+        id_t left = egraph.add_expr(Expr::make_operator(mul, {Expr::make_operator(mul, {a_expr, b_expr}), c_expr}));
+        id_t right = egraph.add_expr(Expr::make_operator(mul, {a_expr, Expr::make_operator(mul, {b_expr, c_expr})}));
+
+        egraph.rebuild();
+
+        REQUIRE_FALSE(egraph.is_equiv(left, right));
+        REQUIRE(egraph.ac_limit_counters().lazy > 0);
+    }
+}
+
+TEST_CASE("AC flattening respects growth limits", "[egraph][ac][nested][limits]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto mul = theory.add_operator("mul", AC);
+
+    auto a_expr = Expr::make_operator(a);
+    auto b_expr = Expr::make_operator(b);
+    auto c_expr = Expr::make_operator(c);
+
+    auto run = [&](const ACLimits& limits) {
+        EGraph egraph(theory);
+        egraph.set_ac_limits(limits);
+
+        // mul(mul(a, b), c) vs mul(a, mul(b, c)), which only meet in mul(a, b, c)
+        id_t left = egraph.add_expr(Expr::make_operator(mul, {Expr::make_operator(mul, {a_expr, b_expr}), c_expr}));
+        id_t right = egraph.add_expr(Expr::make_operator(mul, {a_expr, Expr::make_operator(mul, {b_expr, c_expr})}));
+
+        for (int i = 0; i < 3; ++i)
+            egraph.rebuild();
+
+        return std::make_pair(egraph.is_equiv(left, right), egraph.ac_limit_counters());
+    };
+
+    SECTION("Unbounded by default")
+    {
+        auto [equiv, counters] = run(ACLimits{});
+
+        REQUIRE(equiv);
+        REQUIRE(counters.derived == 0);
+        REQUIRE(counters.size == 0);
+        REQUIRE(counters.depth == 0);
+        REQUIRE(counters.lazy == 0);
+    }
+
+    SECTION("Depth")
+    {
+        ACLimits limits;
+        limits.max_depth = 0;
+
+        auto [equiv, counters] = run(limits);
+
+        REQUIRE_FALSE(equiv);
+        REQUIRE(counters.depth > 0);
+    }
+
+    SECTION("Size")
+    {
+        ACLimits limits;
+        limits.max_size = 2;
+
+        auto [equiv, counters] = run(limits);
+
+        REQUIRE_FALSE(equiv);
+        REQUIRE(counters.size > 0);
+    }
+
+    SECTION("Derived tuples per rebuild")
+    {
+        ACLimits limits;
+        limits.max_derived = 0;
+
+        auto [equiv, counters] = run(limits);
+
+        REQUIRE_FALSE(equiv);
+        REQUIRE(counters.derived > 0);
+    }
+}
+
+TEST_CASE("AC rest variables bind the remaining children", "[egraph][ac][rest]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto e = theory.add_operator("e", 0);
+    auto inv = theory.add_operator("inv", 1);
+    auto mul = theory.add_operator("mul", AC);
+
+    auto a_expr = Expr::make_operator(a);
+    auto b_expr = Expr::make_operator(b);
+    auto c_expr = Expr::make_operator(c);
+    auto e_expr = Expr::make_operator(e);
+    auto inv_a = Expr::make_operator(inv, {a_expr});
+
+    SECTION("Remainder is spliced under the same operator")
+    {
+        theory.add_rewrite_rule("cancel", "(mul ?x (inv ?x) ?rest...)", "(mul (e) ?rest...)");
+        EGraph egraph(theory);
+
+        id_t lhs = egraph.add_expr(Expr::make_operator(mul, {a_expr, b_expr, inv_a, c_expr}));
+        id_t rhs = egraph.add_expr(Expr::make_operator(mul, {e_expr, b_expr, c_expr}));
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(lhs, rhs));
+    }
+
+    SECTION("Single remaining child stands for itself")
+    {
+        theory.add_rewrite_rule("drop", "(mul ?x (inv ?x) ?rest...)", "(mul ?rest...)");
+        EGraph egraph(theory);
+
+        id_t lhs = egraph.add_expr(Expr::make_operator(mul, {a_expr, inv_a, b_expr}));
+        id_t b_id = egraph.add_expr(b_expr);
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(lhs, b_id));
+    }
+
+    SECTION("Empty remainder of an operator without unit skips the match")
+    {
+        theory.add_rewrite_rule("drop", "(mul ?x (inv ?x) ?rest...)", "(mul ?rest...)");
+        EGraph egraph(theory);
+
+        id_t lhs = egraph.add_expr(Expr::make_operator(mul, {a_expr, inv_a}));
+        id_t other = egraph.add_expr(Expr::make_operator(mul, {a_expr, inv_a, b_expr}));
+        id_t b_id = egraph.add_expr(b_expr);
+
+        egraph.saturate(1);
+
+        // mul() is no term, so only the match with a non-empty remainder applies
+        REQUIRE(egraph.is_equiv(other, b_id));
+        REQUIRE_FALSE(egraph.is_equiv(lhs, b_id));
+        REQUIRE_FALSE(egraph.lookup(ENode(mul, {})).has_value());
+    }
+
+    SECTION("Empty remainder of an ACU operator is the unit")
+    {
+        Theory acu;
+        acu.add_operator("a", 0);
+        acu.add_operator("inv", 1);
+        auto times = acu.add_operator("times", AC, "one");
+        acu.add_rewrite_rule("drop", "(times ?x (inv ?x) ?rest...)", "(times ?rest...)");
+        EGraph egraph(acu);
+
+        auto a_term = Expr::make_operator(acu.intern("a"));
+        auto inv_term = Expr::make_operator(acu.intern("inv"), {a_term});
+
+        id_t lhs = egraph.add_expr(Expr::make_operator(times, {a_term, inv_term}));
+        id_t one = egraph.add_expr(Expr::make_operator(acu.intern("one")));
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(lhs, one));
+    }
+
+    SECTION("Remainder under a different operator is materialized")
+    {
+        theory.add_rewrite_rule("wrap", "(mul (e) ?rest...)", "(inv ?rest...)");
+        EGraph egraph(theory);
+
+        id_t lhs = egraph.add_expr(Expr::make_operator(mul, {e_expr, b_expr, c_expr}));
+        id_t rhs = egraph.add_expr(Expr::make_operator(inv, {Expr::make_operator(mul, {b_expr, c_expr})}));
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(lhs, rhs));
+    }
+
+    SECTION("Misplaced rest variables are rejected")
+    {
+        REQUIRE_THROWS(theory.add_rewrite_rule("bad", "(inv ?rest...)", "(e)"));
+        REQUIRE_THROWS(theory.add_rewrite_rule("bad", "(mul ?r... ?s...)", "(e)"));
+    }
+}
+
 TEST_CASE("AC operators with multiple rewrite rules interacting", "[egraph][ac][rules]")
 {
     Theory theory;
@@ -333,6 +333,158 @@ TEST_CASE("AC interaction with rebuild after unification", "[egraph][ac][rebuild
     }
 }
 
+TEST_CASE("AC rebuild closes long congruence cascades at once", "[egraph][ac][rebuild]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto k = theory.add_operator("k", 0);
+    auto mul = theory.add_operator("mul", AC);
+
+    EGraph egraph(theory);
+
+    // x_i = mul(x_{i-1}, k) and y_i = mul(y_{i-1}, k) with x_0 = a and y_0 = b
+    auto x = Expr::make_operator(a);
+    auto y = Expr::make_operator(b);
+
+    id_t a_id = egraph.add_expr(x);
+    id_t b_id = egraph.add_expr(y);
+
+    for (int i = 0; i < 50; ++i)
+    {
+        x = Expr::make_operator(mul, {x, Expr::make_operator(k)});
+        y = Expr::make_operator(mul, {y, Expr::make_operator(k)});
+    }
+
+    id_t x_id = egraph.add_expr(x);
+    id_t y_id = egraph.add_expr(y);
+
+    egraph.rebuild();
+    REQUIRE(egraph.is_equiv(x_id, y_id) == false);
+
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(x_id, y_id) == true);
+}
+
+TEST_CASE("AC rebuild handles merges between consecutive rebuilds", "[egraph][ac][rebuild]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto f = theory.add_operator("f", 1);
+    auto mul = theory.add_operator("mul", AC);
+
+    EGraph egraph(theory);
+
+    id_t a_id = egraph.add_enode(a, {});
+    id_t b_id = egraph.add_enode(b, {});
+    id_t c_id = egraph.add_enode(c, {});
+    id_t fa = egraph.add_enode(f, {a_id});
+    id_t fb = egraph.add_enode(f, {b_id});
+
+    id_t x = egraph.add_enode(mul, {fa, c_id});
+    id_t y = egraph.add_enode(mul, {c_id, fb});
+
+    egraph.rebuild();
+    REQUIRE(egraph.is_equiv(x, y) == false);
+
+    // f(a) = f(b) is found by another relation during the same rebuild
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(x, y) == true);
+
+    // tuples added after a rebuild take part in the next one
+    id_t z = egraph.add_enode(mul, {a_id, c_id});
+    id_t w = egraph.add_enode(mul, {b_id, b_id});
+    REQUIRE(egraph.is_equiv(z, w) == false);
+
+    egraph.unify(c_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(z, w) == true);
+    REQUIRE(egraph.is_equiv(x, egraph.add_enode(mul, {fa, a_id})) == true);
+}
+
+TEST_CASE("AC rebuild drops tuples which became equal", "[egraph][ac][rebuild]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto mul = theory.add_operator("mul", AC);
+
+    EGraph egraph(theory);
+
+    id_t a_id = egraph.add_enode(a, {});
+    id_t b_id = egraph.add_enode(b, {});
+    id_t c_id = egraph.add_enode(c, {});
+
+    id_t x = egraph.add_enode(mul, {a_id, c_id});
+    id_t y = egraph.add_enode(mul, {b_id, c_id});
+
+    auto count = [&]() {
+        size_t n = 0;
+        egraph.for_each_term([&](Symbol op, const id_t *, size_t, id_t) { n += op == mul; });
+        return n;
+    };
+
+    egraph.rebuild();
+    REQUIRE(count() == 2);
+
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(x, y));
+    REQUIRE(count() == 1);
+
+    // the surviving tuple still takes part in flattening, also after the dropped one is compacted away
+    id_t nested = egraph.add_enode(mul, {y, b_id});
+    id_t flat = egraph.add_enode(mul, {a_id, a_id, c_id});
+    egraph.rebuild();
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(nested, flat));
+}
+
+TEST_CASE("AC rebuild feeds its merges back to the other relations", "[egraph][ac][rebuild]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto f = theory.add_operator("f", 1);
+    auto mul = theory.add_operator("mul", AC);
+
+    EGraph egraph(theory);
+
+    id_t a_id = egraph.add_enode(a, {});
+    id_t b_id = egraph.add_enode(b, {});
+    id_t c_id = egraph.add_enode(c, {});
+
+    id_t x = egraph.add_enode(mul, {a_id, c_id});
+    id_t y = egraph.add_enode(mul, {c_id, b_id});
+    id_t fx = egraph.add_enode(f, {x});
+    id_t fy = egraph.add_enode(f, {y});
+
+    egraph.rebuild();
+    REQUIRE(egraph.is_equiv(fx, fy) == false);
+
+    // only the AC relation finds x = y, f(x) = f(y) follows in the same rebuild
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(x, y) == true);
+    REQUIRE(egraph.is_equiv(fx, fy) == true);
+}
+
 TEST_CASE("AC operators support more complex pattern matching", "[egraph][ac][pattern][inverse]")
 {
     Theory theory;
@@ -367,3 +519,62 @@ TEST_CASE("AC operators support more complex pattern matching", "[egraph][ac][pa
         REQUIRE(egraph.is_equiv(a_id, mul_id) == true);
     }
 }
+
+TEST_CASE("ACI operators ignore repeated children", "[egraph][ac][idempotent]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto andd = theory.add_operator("and", ACI);
+
+    SECTION("Repeated children are dropped from new terms")
+    {
+        EGraph egraph(theory);
+
+        id_t a_id = egraph.add_enode(a, {});
+        id_t b_id = egraph.add_enode(b, {});
+
+        REQUIRE(egraph.add_enode(andd, {a_id, a_id}) == a_id);
+        REQUIRE(egraph.add_enode(andd, {a_id, b_id, a_id}) == egraph.add_enode(andd, {b_id, a_id}));
+    }
+
+    SECTION("Terms shrink once children become equal")
+    {
+        EGraph egraph(theory);
+
+        id_t a_id = egraph.add_enode(a, {});
+        id_t b_id = egraph.add_enode(b, {});
+        id_t c_id = egraph.add_enode(c, {});
+
+        id_t ab = egraph.add_enode(andd, {a_id, b_id});
+        id_t abc = egraph.add_enode(andd, {a_id, b_id, c_id});
+        id_t ac = egraph.add_enode(andd, {a_id, c_id});
+
+        egraph.unify(a_id, b_id);
+        egraph.rebuild();
+
+        REQUIRE(egraph.is_equiv(ab, a_id));
+        REQUIRE(egraph.is_equiv(abc, ac));
+        REQUIRE_FALSE(egraph.is_equiv(ac, a_id));
+    }
+
+    SECTION("Flattening yields sets")
+    {
+        EGraph egraph(theory);
+
+        auto a_expr = Expr::make_operator(a);
+        auto b_expr = Expr::make_operator(b);
+
+        // and(a, and(a, b)) = and(a, b)
+        id_t inner = egraph.add_expr(Expr::make_operator(andd, {a_expr, b_expr}));
+        id_t outer = egraph.add_expr(Expr::make_operator(andd, {a_expr, Expr::make_operator(andd, {a_expr, b_expr})}));
+
+        // the first rebuild flattens, the second one finds the congruence
+        egraph.rebuild();
+        egraph.rebuild();
+
+        REQUIRE(egraph.is_equiv(inner, outer));
+    }
+}
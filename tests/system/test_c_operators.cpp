@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "egraph.h"
+#include "theory.h"
+
+using namespace eqsat;
+
+// These tests verify commutative (C) operator behavior: binary operators
+// whose argument order is irrelevant, but which are not associative.
+
+TEST_CASE("C operators enforce commutative hash-consing", "[egraph][c][hashcons]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto nand = theory.add_operator("nand", C);
+
+    EGraph egraph(theory);
+
+    id_t a_id = egraph.add_enode(a, {});
+    id_t b_id = egraph.add_enode(b, {});
+
+    id_t ab = egraph.add_enode(nand, {a_id, b_id});
+    id_t ba = egraph.add_enode(nand, {b_id, a_id});
+
+    REQUIRE(ab == ba);
+    REQUIRE(egraph.lookup(ENode(nand, {b_id, a_id})) == ab);
+}
+
+TEST_CASE("C operators match both argument orders", "[egraph][c][pattern]")
+{
+    Theory theory;
+
+    theory.add_operator("a", 0);
+    theory.add_operator("zero", 0);
+    theory.add_operator("xor", C);
+
+    theory.add_rewrite_rule("xor-zero", "(xor ?x (zero))", "?x");
+
+    EGraph egraph(theory);
+
+    SECTION("Forward order")
+    {
+        id_t a_id = egraph.add_expr("(a)");
+        id_t xor_id = egraph.add_expr("(xor (a) (zero))");
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(a_id, xor_id));
+    }
+
+    SECTION("Reverse order")
+    {
+        id_t a_id = egraph.add_expr("(a)");
+        id_t xor_id = egraph.add_expr("(xor (zero) (a))");
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(a_id, xor_id));
+    }
+}
+
+TEST_CASE("C operators bind both orientations of a match", "[egraph][c][pattern]")
+{
+    Theory theory;
+
+    theory.add_operator("a", 0);
+    theory.add_operator("b", 0);
+    theory.add_operator("nand", C);
+    theory.add_operator("pair", 2);
+
+    // the RHS is not symmetric, so both orientations have to be instantiated
+    theory.add_rewrite_rule("split", "(nand ?x ?y)", "(pair ?x ?y)");
+
+    EGraph egraph(theory);
+
+    id_t nand_id = egraph.add_expr("(nand (a) (b))");
+
+    egraph.saturate(1);
+
+    REQUIRE(egraph.is_equiv(nand_id, egraph.add_expr("(pair (a) (b))")));
+    REQUIRE(egraph.is_equiv(nand_id, egraph.add_expr("(pair (b) (a))")));
+}
+
+TEST_CASE("C operators support congruence closure", "[egraph][c][congruence]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto nand = theory.add_operator("nand", C);
+
+    EGraph egraph(theory);
+
+    id_t a_id = egraph.add_enode(a, {});
+    id_t b_id = egraph.add_enode(b, {});
+    id_t c_id = egraph.add_enode(c, {});
+
+    id_t ac = egraph.add_enode(nand, {a_id, c_id});
+    id_t cb = egraph.add_enode(nand, {c_id, b_id});
+
+    REQUIRE_FALSE(egraph.is_equiv(ac, cb));
+
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(ac, cb));
+}
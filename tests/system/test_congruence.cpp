@@ -66,3 +66,168 @@ TEST_CASE("EGraph proves g(f(a)) = g(f(b)) via congruence of a=b", "[egraph][rew
 
     REQUIRE(egraph.is_equiv(gfa, gfb) == true);
 }
+
+TEST_CASE("EGraph rebuild propagates congruence through a chain in one call", "[egraph][congruence][rebuild]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto f = theory.add_operator("f", 1);
+
+    EGraph egraph(theory);
+
+    auto fa = Expr::make_operator(a);
+    auto fb = Expr::make_operator(b);
+
+    auto a_id = egraph.add_expr(fa);
+    auto b_id = egraph.add_expr(fb);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        fa = Expr::make_operator(f, {fa});
+        fb = Expr::make_operator(f, {fb});
+    }
+
+    auto fa_id = egraph.add_expr(fa);
+    auto fb_id = egraph.add_expr(fb);
+
+    // settle the relation first so the merge below takes the incremental path
+    egraph.rebuild();
+
+    egraph.unify(a_id, b_id);
+
+    REQUIRE(egraph.is_equiv(fa_id, fb_id) == false);
+
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(fa_id, fb_id) == true);
+}
+
+TEST_CASE("EGraph rebuild handles merges between consecutive rebuilds", "[egraph][congruence][rebuild]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto g = theory.add_operator("g", 2);
+
+    EGraph egraph(theory);
+
+    auto a_expr = Expr::make_operator(a);
+    auto b_expr = Expr::make_operator(b);
+    auto c_expr = Expr::make_operator(c);
+
+    auto a_id = egraph.add_expr(a_expr);
+    auto b_id = egraph.add_expr(b_expr);
+    auto c_id = egraph.add_expr(c_expr);
+
+    auto gab = egraph.add_expr(Expr::make_operator(g, {a_expr, b_expr}));
+    auto gba = egraph.add_expr(Expr::make_operator(g, {b_expr, a_expr}));
+    auto gcc = egraph.add_expr(Expr::make_operator(g, {c_expr, c_expr}));
+
+    egraph.rebuild();
+
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(gab, gba) == true);
+    REQUIRE(egraph.is_equiv(gab, gcc) == false);
+
+    // tuples added after the first rebuild must take part as well
+    auto gac = egraph.add_expr(Expr::make_operator(g, {a_expr, c_expr}));
+    auto gbc = egraph.add_expr(Expr::make_operator(g, {b_expr, c_expr}));
+
+    REQUIRE(egraph.is_equiv(gac, gbc) == true);
+
+    egraph.unify(c_id, b_id);
+    egraph.rebuild();
+
+    REQUIRE(egraph.is_equiv(gab, gcc) == true);
+    REQUIRE(egraph.is_equiv(gac, gcc) == true);
+}
+
+TEST_CASE("EGraph parallel rebuild matches serial rebuild", "[egraph][congruence][rebuild]")
+{
+    Theory theory;
+
+    auto z = theory.add_operator("z", 0);
+    auto s = theory.add_operator("s", 1);
+    auto add = theory.add_operator("+", 2);
+    auto mul = theory.add_operator("*", 2);
+
+    // large enough to exceed the threshold for spawning threads
+    const int n = 80;
+
+    auto populate = [&](EGraph& egraph) {
+        Vec<std::shared_ptr<Expr>> nums{Expr::make_operator(z)};
+        for (int i = 1; i < n; ++i)
+            nums.push_back(Expr::make_operator(s, {nums.back()}));
+
+        Vec<id_t> ids;
+        for (const auto& num : nums)
+            ids.push_back(egraph.add_expr(num));
+
+        for (int i = 0; i < n; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                ids.push_back(egraph.add_expr(Expr::make_operator(add, {nums[i], nums[j]})));
+                ids.push_back(egraph.add_expr(Expr::make_operator(mul, {nums[i], nums[j]})));
+            }
+        }
+
+        egraph.rebuild();
+
+        // s^3(z) = z makes the numbers collapse modulo 3
+        egraph.unify(ids[0], ids[3]);
+        egraph.rebuild();
+
+        return ids;
+    };
+
+    EGraph serial(theory);
+    serial.set_rebuild_threads(1);
+    auto serial_ids = populate(serial);
+
+    EGraph parallel(theory);
+    parallel.set_rebuild_threads(4);
+    auto parallel_ids = populate(parallel);
+
+    REQUIRE(serial_ids == parallel_ids);
+
+    for (size_t i = 0; i < serial_ids.size(); ++i)
+        REQUIRE(serial.canonicalize(serial_ids[i]) == parallel.canonicalize(parallel_ids[i]));
+
+    REQUIRE(serial.is_equiv(serial_ids[1], serial_ids[4]));
+    REQUIRE_FALSE(serial.is_equiv(serial_ids[1], serial_ids[2]));
+}
+
+TEST_CASE("EGraph lookup finds terms under their canonical children after a rebuild", "[egraph][congruence][hashcons]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto g = theory.add_operator("g", 2);
+
+    EGraph egraph(theory);
+
+    auto a_id = egraph.add_enode(a, {});
+    auto b_id = egraph.add_enode(b, {});
+    auto gab = egraph.add_enode(g, {a_id, b_id});
+
+    REQUIRE(egraph.lookup(ENode(g, {a_id, b_id})) == gab);
+    REQUIRE_FALSE(egraph.lookup(ENode(g, {a_id, a_id})).has_value());
+
+    egraph.unify(a_id, b_id);
+    egraph.rebuild();
+
+    // both children now have the same root, the stored tuple followed it
+    auto found = egraph.lookup(ENode(g, {a_id, a_id}));
+    REQUIRE(found.has_value());
+    REQUIRE(egraph.is_equiv(*found, gab));
+
+    REQUIRE(egraph.is_equiv(egraph.add_enode(g, {b_id, b_id}), gab));
+}
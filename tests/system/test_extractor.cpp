@@ -0,0 +1,163 @@
+#include <stdexcept>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "egraph.h"
+#include "extractor.h"
+#include "theory.h"
+
+using namespace eqsat;
+
+TEST_CASE("Extractor picks the smallest term of an e-class", "[egraph][extractor]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto f = theory.add_operator("f", 1);
+    auto g = theory.add_operator("g", 2);
+
+    EGraph egraph(theory);
+
+    id_t a_id = egraph.add_enode(a, {});
+    id_t b_id = egraph.add_enode(b, {});
+    id_t fa = egraph.add_enode(f, {a_id});
+    id_t gfab = egraph.add_enode(g, {fa, b_id});
+
+    egraph.unify(fa, b_id);
+    egraph.rebuild();
+
+    Extractor extractor(egraph);
+
+    REQUIRE(extractor.cost(fa) == 1.0);
+    REQUIRE(extractor.extract(fa)->to_sexpr(theory.symbols) == "(b)");
+
+    REQUIRE(extractor.cost(gfab) == 3.0);
+    REQUIRE(extractor.extract(gfab)->to_sexpr(theory.symbols) == "(g (b) (b))");
+
+    SECTION("A custom cost function changes the choice")
+    {
+        auto cost = [b](Symbol op, size_t) { return op == b ? 10.0 : 1.0; };
+        Extractor custom(egraph, cost);
+
+        REQUIRE(custom.cost(fa) == 2.0);
+        REQUIRE(custom.extract(gfab)->to_sexpr(theory.symbols) == "(g (f (a)) (f (a)))");
+    }
+
+    SECTION("Non-positive costs are rejected")
+    {
+        auto cost = [](Symbol, size_t) { return 0.0; };
+        REQUIRE_THROWS_AS(Extractor(egraph, cost), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Extractor handles cyclic e-classes", "[egraph][extractor]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto f = theory.add_operator("f", 1);
+    auto g = theory.add_operator("g", 1);
+
+    EGraph egraph(theory);
+
+    // x = f(x) = a and y = g(y) without a finite term
+    id_t a_id = egraph.add_enode(a, {});
+    id_t fa = egraph.add_enode(f, {a_id});
+    id_t ffa = egraph.add_enode(f, {fa});
+    id_t gffa = egraph.add_enode(g, {ffa});
+
+    egraph.unify(fa, a_id);
+    egraph.rebuild();
+
+    Extractor extractor(egraph);
+
+    REQUIRE(egraph.is_equiv(ffa, a_id));
+    REQUIRE(extractor.extract(ffa)->to_sexpr(theory.symbols) == "(a)");
+    REQUIRE(extractor.extract(gffa)->to_sexpr(theory.symbols) == "(g (a))");
+
+    egraph.unify(gffa, ffa);
+    egraph.rebuild();
+
+    Extractor after(egraph);
+    REQUIRE(after.extract(gffa)->to_sexpr(theory.symbols) == "(a)");
+}
+
+TEST_CASE("Extractor returns flat AC terms", "[egraph][extractor][ac]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto c = theory.add_operator("c", 0);
+    auto mul = theory.add_operator("mul", AC);
+
+    EGraph egraph(theory);
+
+    auto a_expr = Expr::make_operator(a);
+    auto b_expr = Expr::make_operator(b);
+    auto c_expr = Expr::make_operator(c);
+
+    // mul(mul(a, b), mul(c, a)) is flattened to mul(a, a, b, c)
+    auto ab = Expr::make_operator(mul, {a_expr, b_expr});
+    auto ca = Expr::make_operator(mul, {c_expr, a_expr});
+    id_t root = egraph.add_expr(Expr::make_operator(mul, {ab, ca}));
+
+    // each rebuild flattens one more level
+    egraph.rebuild();
+    egraph.rebuild();
+
+    Extractor extractor(egraph);
+
+    REQUIRE(extractor.cost(root) == 5.0);
+    REQUIRE(extractor.extract(root)->nchildren() == 4);
+
+    SECTION("Costs may depend on the number of children")
+    {
+        // a binary application per child but the first, like nested terms cost
+        auto cost = [mul](Symbol op, size_t nchildren) { return op == mul ? nchildren - 1.0 : 1.0; };
+        Extractor binary(egraph, cost);
+
+        REQUIRE(binary.cost(root) == 7.0);
+    }
+}
+
+TEST_CASE("Extractor gives the same result on any number of threads", "[egraph][extractor]")
+{
+    Theory theory;
+
+    auto a = theory.add_operator("a", 0);
+    auto f = theory.add_operator("f", 1);
+    auto g = theory.add_operator("g", 2);
+
+    EGraph egraph(theory);
+
+    // a wide and deep DAG with many independent components per level
+    Vec<id_t> layer;
+    for (int i = 0; i < 64; ++i)
+    {
+        id_t id = egraph.add_enode(a, {});
+        for (int j = 0; j < i % 5; ++j)
+            id = egraph.add_enode(f, {id});
+
+        layer.push_back(id);
+    }
+
+    while (layer.size() > 1)
+    {
+        Vec<id_t> next;
+        for (size_t i = 0; i + 1 < layer.size(); i += 2)
+            next.push_back(egraph.add_enode(g, {layer[i], layer[i + 1]}));
+
+        layer = next;
+    }
+
+    egraph.rebuild();
+
+    Extractor serial(egraph, Extractor::ast_size, 1);
+    Extractor parallel(egraph, Extractor::ast_size, 8);
+
+    REQUIRE(serial.cost(layer[0]) == parallel.cost(layer[0]));
+    REQUIRE(serial.extract(layer[0])->to_sexpr(theory.symbols) ==
+            parallel.extract(layer[0])->to_sexpr(theory.symbols));
+}
@@ -101,3 +101,65 @@ TEST_CASE("EGraph applies multiplicative identity rewrite rule", "[egraph][rewri
         REQUIRE(egraph.is_equiv(var_id, one_id) == false);
     }
 }
+
+TEST_CASE("ACU operators need no identity rule", "[egraph][ac][identity]")
+{
+    Theory theory;
+
+    auto one = theory.add_operator("one", 0);
+    auto a = theory.add_operator("a", 0);
+    auto b = theory.add_operator("b", 0);
+    auto mul = theory.add_operator("mul", AC, "one");
+
+    SECTION("The unit is dropped from new terms")
+    {
+        EGraph egraph(theory);
+
+        id_t a_id = egraph.add_enode(a, {});
+        id_t b_id = egraph.add_enode(b, {});
+        id_t one_id = egraph.add_enode(one, {});
+
+        REQUIRE(egraph.add_enode(mul, {a_id, one_id}) == a_id);
+        REQUIRE(egraph.add_enode(mul, {one_id, one_id}) == one_id);
+        REQUIRE(egraph.add_enode(mul, {}) == one_id);
+        REQUIRE(egraph.add_enode(mul, {a_id, one_id, b_id}) == egraph.add_enode(mul, {b_id, a_id}));
+    }
+
+    SECTION("Terms collapse once a child becomes the unit")
+    {
+        EGraph egraph(theory);
+
+        id_t a_id = egraph.add_enode(a, {});
+        id_t b_id = egraph.add_enode(b, {});
+        id_t ab = egraph.add_enode(mul, {a_id, b_id});
+
+        egraph.unify(b_id, egraph.add_enode(one, {}));
+        egraph.rebuild();
+
+        REQUIRE(egraph.is_equiv(ab, a_id));
+    }
+
+    SECTION("Patterns see the unit in every term")
+    {
+        theory.add_operator("f", 1);
+        theory.add_operator("g", 1);
+
+        // matches mul(f(a), b) with the implicit unit, its e-class is f(a) itself
+        theory.add_rewrite_rule("fg", "(mul (f ?x) (one))", "(g ?x)");
+
+        EGraph egraph(theory);
+
+        id_t fa = egraph.add_expr("(f (a))");
+        egraph.add_expr("(mul (f (a)) (b))");
+
+        egraph.saturate(1);
+
+        REQUIRE(egraph.is_equiv(fa, egraph.add_expr("(g (a))")));
+    }
+
+    SECTION("Only nullary units of AC operators are accepted")
+    {
+        REQUIRE_THROWS_AS(theory.add_operator("add", 2, "zero"), std::invalid_argument);
+        REQUIRE_THROWS_AS(theory.add_operator("add", AC, "mul"), std::invalid_argument);
+    }
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "indices/commutative_index.h"
+#include "relations/relation_c.h"
+#include "utils/permutation.h"
+
+using namespace eqsat;
+
+namespace
+{
+
+Vec<id_t> elements(const AbstractSet& set)
+{
+    Vec<id_t> out;
+    set.for_each([&out](id_t id) { out.push_back(id); });
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+} // namespace
+
+TEST_CASE("CommutativeIndex matches both argument orders", "[commutative_index]")
+{
+    Symbol nand = 7;
+    RelationC rel(nand);
+
+    rel.add_tuple({1, 2, 10});
+    rel.add_tuple({3, 1, 11});
+    rel.add_tuple({2, 2, 12});
+    rel.add_tuple({3, 2, 13});
+
+    SECTION("Arguments first")
+    {
+        auto index = rel.populate_index(0); // (arg1, arg2, id)
+
+        REQUIRE(elements(index.project()) == Vec<id_t>{1, 2, 3});
+
+        // 2 is the smaller argument of (2, 2) and (2, 3) and the larger one of (1, 2)
+        index.select(2);
+        REQUIRE(elements(index.project()) == Vec<id_t>{1, 2, 3});
+
+        index.select(1);
+        REQUIRE(elements(index.project()) == Vec<id_t>{10});
+        index.unselect();
+
+        index.select(2);
+        REQUIRE(elements(index.project()) == Vec<id_t>{12});
+        index.unselect();
+
+        index.select(3);
+        REQUIRE(elements(index.project()) == Vec<id_t>{13});
+        index.unselect();
+        index.unselect();
+
+        // 3 is never the smaller argument
+        index.select(3);
+        REQUIRE(elements(index.project()) == Vec<id_t>{1, 2});
+        index.select(1);
+        REQUIRE(elements(index.project()) == Vec<id_t>{11});
+    }
+
+    SECTION("E-class between the arguments")
+    {
+        auto index = rel.populate_index(permutation_to_index({0, 2, 1})); // (arg1, id, arg2)
+
+        index.select(2);
+        REQUIRE(elements(index.project()) == Vec<id_t>{10, 12, 13});
+
+        index.select(10);
+        REQUIRE(elements(index.project()) == Vec<id_t>{1});
+        index.unselect();
+
+        index.select(13);
+        REQUIRE(elements(index.project()) == Vec<id_t>{3});
+        index.unselect();
+        index.unselect();
+
+        index.select(3);
+        REQUIRE(elements(index.project()) == Vec<id_t>{11, 13});
+    }
+
+    SECTION("E-class first")
+    {
+        auto index = rel.populate_index(permutation_to_index({2, 0, 1})); // (id, arg1, arg2)
+
+        REQUIRE(elements(index.project()) == Vec<id_t>{10, 11, 12, 13});
+
+        index.select(13);
+        REQUIRE(elements(index.project()) == Vec<id_t>{2, 3});
+
+        index.select(3);
+        REQUIRE(elements(index.project()) == Vec<id_t>{2});
+        index.unselect();
+
+        index.select(2);
+        REQUIRE(elements(index.project()) == Vec<id_t>{3});
+        index.unselect();
+        index.unselect();
+
+        index.select(12);
+        REQUIRE(elements(index.project()) == Vec<id_t>{2});
+        index.select(2);
+        REQUIRE(elements(index.project()) == Vec<id_t>{2});
+    }
+
+    SECTION("Reset returns to the root")
+    {
+        auto index = rel.populate_index(0);
+
+        index.select(3);
+        index.select(2);
+        index.reset();
+
+        REQUIRE(elements(index.project()) == Vec<id_t>{1, 2, 3});
+    }
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "../src/compiler.h"
 #include "../src/symbol_table.h"
 #include "../src/theory.h"
@@ -128,3 +130,76 @@ TEST_CASE("Multiple patterns compilation", "[pattern_compiler]")
     REQUIRE(kernels[1].first.head.size() == 1);
     REQUIRE(kernels[1].first.head[0] == 0);
 }
+
+TEST_CASE("Interchangeable variables compilation", "[pattern_compiler][symmetry]")
+{
+    Theory theory;
+    theory.add_operator("f", 2);
+    theory.add_operator("add", AC);
+    theory.add_operator("mul", AC);
+
+    Compiler compiler(theory);
+
+    SECTION("Children of one AC operator")
+    {
+        auto rule = theory.add_rewrite_rule("comm", "(mul ?x ?y)", "(mul ?y ?x)");
+        auto [query, subst] = compiler.compile(rule);
+
+        // head: x, y, root
+        REQUIRE(query.symmetries == Vec<std::pair<var_t, var_t>>{{query.head[0], query.head[1]}});
+    }
+
+    SECTION("Asymmetric RHS")
+    {
+        auto rule = theory.add_rewrite_rule("ordered", "(mul ?x ?y)", "(f ?x ?y)");
+        auto [query, subst] = compiler.compile(rule);
+
+        REQUIRE(query.symmetries.empty());
+    }
+
+    SECTION("Variables under different AC terms")
+    {
+        auto rule = theory.add_rewrite_rule("factor", "(add (mul ?x ?y) (mul ?x ?z))", "(mul ?x (add ?y ?z))");
+        auto [query, subst] = compiler.compile(rule);
+
+        // head: x, y, z, root; only y and z can be swapped
+        REQUIRE(query.symmetries == Vec<std::pair<var_t, var_t>>{{query.head[1], query.head[2]}});
+    }
+
+    SECTION("Groups of more than two variables are chained")
+    {
+        auto rule = theory.add_rewrite_rule("three", "(mul ?x ?y ?z)", "(add ?z ?y ?x)");
+        auto [query, subst] = compiler.compile(rule);
+
+        Vec<std::pair<var_t, var_t>> expected = {{query.head[0], query.head[1]}, {query.head[1], query.head[2]}};
+        REQUIRE(query.symmetries == expected);
+    }
+
+    SECTION("Children of a non-AC operator")
+    {
+        auto rule = theory.add_rewrite_rule("nested", "(mul ?x (f ?y ?z))", "(mul ?x (f ?y ?z))");
+        auto [query, subst] = compiler.compile(rule);
+
+        REQUIRE(query.symmetries.empty());
+    }
+}
+
+TEST_CASE("C constraints need a single index each", "[pattern_compiler][c]")
+{
+    Theory theory;
+    auto f = theory.add_operator("f", 1);
+    auto nand = theory.add_operator("nand", C);
+
+    Compiler compiler(theory);
+
+    auto rule = theory.add_rewrite_rule("nested", "(nand (nand ?x ?y) (f ?z))", "(f ?x)");
+    auto [query, subst] = compiler.compile(rule);
+
+    REQUIRE(query.constraints.size() == 3);
+
+    // the index of a C relation yields both argument orders by itself
+    auto required = query.get_required_indices();
+    REQUIRE(required.size() == 3);
+    REQUIRE(std::count_if(required.begin(), required.end(), [&](const auto& r) { return r.first == nand; }) == 2);
+    REQUIRE(std::count_if(required.begin(), required.end(), [&](const auto& r) { return r.first == f; }) == 1);
+}
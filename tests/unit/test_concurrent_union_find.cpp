@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "concurrent_union_find.h"
+#include "union_find.h"
+
+using namespace eqsat;
+
+TEST_CASE("ConcurrentUnionFind behaves like UnionFind on one thread", "[union_find][concurrent]")
+{
+    ConcurrentUnionFind uf;
+
+    id_t id1 = uf.make_set();
+    id_t id2 = uf.make_set();
+    id_t id3 = uf.make_set();
+    id_t id4 = uf.make_set();
+
+    REQUIRE(uf.unify(id3, id2) == id2);
+    REQUIRE(uf.unify(id4, id3) == id2);
+    REQUIRE(uf.unify(id3, id4) == id2);
+
+    REQUIRE(uf.same(id2, id4));
+    REQUIRE_FALSE(uf.same(id1, id2));
+    REQUIRE(uf.eclasses() == 2);
+
+    uf.sync_log();
+    REQUIRE(uf.union_log().size() == 2);
+    REQUIRE(uf.union_log()[0] == id3);
+    REQUIRE(uf.union_log()[1] == id4);
+
+    uf.normalize();
+    REQUIRE(uf.find_root(id4) == id2);
+}
+
+TEST_CASE("ConcurrentUnionFind survives many threads unifying at once", "[union_find][concurrent]")
+{
+    const size_t n = 20000;
+    const size_t npairs = 60000;
+    const size_t nthreads = 8;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<id_t> dist(0, n - 1);
+
+    Vec<std::pair<id_t, id_t>> pairs;
+    for (size_t i = 0; i < npairs; ++i)
+        pairs.push_back({dist(rng), dist(rng)});
+
+    UnionFind expected;
+    ConcurrentUnionFind uf;
+    for (size_t i = 0; i < n; ++i)
+    {
+        expected.make_set();
+        uf.make_set();
+    }
+
+    for (const auto& [a, b] : pairs)
+        expected.unify(a, b);
+
+    // every thread takes an interleaved share of the pairs and keeps
+    // finding random ids in between to race with the linking
+    Vec<std::thread> threads;
+    for (size_t t = 0; t < nthreads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            std::mt19937 local(static_cast<uint32_t>(t));
+            for (size_t i = t; i < npairs; i += nthreads)
+            {
+                uf.unify(pairs[i].first, pairs[i].second);
+                (void)uf.find_root(static_cast<id_t>(local() % n));
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    // index-based linking ends up with the lowest ids as roots in any schedule
+    for (size_t i = 0; i < n; ++i)
+        REQUIRE(uf.find_root(static_cast<id_t>(i)) == expected.find_root(static_cast<id_t>(i)));
+
+    REQUIRE(uf.eclasses() == expected.eclasses());
+
+    // each re-rooted id is logged exactly once
+    uf.sync_log();
+    Vec<id_t> log = uf.union_log();
+    std::sort(log.begin(), log.end());
+    REQUIRE(std::adjacent_find(log.begin(), log.end()) == log.end());
+    REQUIRE(log.size() == n - uf.eclasses());
+
+    for (id_t id : log)
+        REQUIRE(uf.find_root(id) != id);
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "database.h"
+#include "symbol_table.h"
+
+using namespace eqsat;
+
+TEST_CASE("Database lookup finds the e-class of stored arguments", "[database]")
+{
+    SymbolTable symbol_table;
+    Database db;
+
+    Symbol add_sym = symbol_table.intern("add");
+
+    SECTION("Standard relations")
+    {
+        db.create_relation(add_sym, 3);
+        db.add_tuple(add_sym, {2, 3, 1});
+        db.add_tuple(add_sym, {1, 5, 4});
+
+        REQUIRE(db.lookup(add_sym, {2, 3}) == 1);
+        REQUIRE(db.lookup(add_sym, {1, 5}) == 4);
+        REQUIRE_FALSE(db.lookup(add_sym, {3, 2}).has_value());
+    }
+
+    SECTION("C relations take the sorted arguments")
+    {
+        db.create_relation_c(add_sym);
+        db.add_tuple(add_sym, {3, 2, 1});
+
+        REQUIRE(db.lookup(add_sym, {2, 3}) == 1);
+    }
+
+    SECTION("A relations keep the order of the arguments")
+    {
+        db.create_relation_a(add_sym);
+        db.add_tuple(add_sym, {2, 3, 5, 1});
+
+        REQUIRE(db.lookup(add_sym, {2, 3, 5}) == 1);
+        REQUIRE_FALSE(db.lookup(add_sym, {5, 3, 2}).has_value());
+        REQUIRE_FALSE(db.lookup(add_sym, {2, 3}).has_value());
+    }
+}
@@ -27,7 +27,7 @@ TEST_CASE("Ephemeral IDs for AC partial multiset matching", "[engine][ac][epheme
         // This is the critical test case for ephemeral IDs!
         // We have: mul(var, var, inv(var))
         // Pattern: mul(?x, inv(?x)) should match with ?x = var
-        // This creates an implicit subterm mul(var, inv(var)) that doesn't exist in memo
+        // This creates an implicit subterm mul(var, inv(var)) that doesn't exist in the hash-cons
         // Engine should create ephemeral ID for this, and apply_match should materialize it
 
         auto var_expr = Expr::make_operator(var);
@@ -113,7 +113,7 @@ TEST_CASE("Ephemeral IDs do not interfere with normal matching", "[engine][ac][e
 
     SECTION("Normal FD optimization still works")
     {
-        // mul(a, one) exists in memo, should use normal FD path
+        // mul(a, one) exists in the hash-cons, should use normal FD path
         auto a_expr = Expr::make_operator(a);
         auto one_expr = Expr::make_operator(one);
         auto mul_expr = Expr::make_operator(mul, {a_expr, one_expr});
@@ -582,3 +582,134 @@ TEST_CASE("Multiset incremental hash invariants", "[multiset][hash]")
         REQUIRE(ms1 == ms2);
     }
 }
+
+TEST_CASE("Multiset inclusion", "[multiset]")
+{
+    Multiset big(Vec<id_t>{1, 2, 2, 3, 5, 8});
+
+    SECTION("Submultisets are included")
+    {
+        REQUIRE(big.includes(Multiset()));
+        REQUIRE(big.includes(Multiset(Vec<id_t>{2, 2})));
+        REQUIRE(big.includes(Multiset(Vec<id_t>{1, 8})));
+        REQUIRE(big.includes(big));
+    }
+
+    SECTION("Multiplicities and missing elements are respected")
+    {
+        REQUIRE_FALSE(big.includes(Multiset(Vec<id_t>{2, 2, 2})));
+        REQUIRE_FALSE(big.includes(Multiset(Vec<id_t>{4})));
+        REQUIRE_FALSE(big.includes(Multiset(Vec<id_t>{1, 9})));
+        REQUIRE_FALSE(Multiset(Vec<id_t>{2}).includes(big));
+    }
+
+    SECTION("Zero-count entries are ignored")
+    {
+        Multiset small(Vec<id_t>{4, 5});
+        small.remove(4);
+
+        REQUIRE(big.includes(small));
+
+        big.remove(1);
+        REQUIRE_FALSE(big.includes(Multiset(Vec<id_t>{1})));
+        REQUIRE(big.includes(Multiset(Vec<id_t>{2, 3})));
+    }
+
+    SECTION("Much larger multisets")
+    {
+        Vec<id_t> elements;
+        for (id_t i = 0; i < 1000; i += 2)
+            elements.push_back(i);
+
+        Multiset huge(elements);
+
+        REQUIRE(huge.includes(Multiset(Vec<id_t>{0, 500, 998})));
+        REQUIRE_FALSE(huge.includes(Multiset(Vec<id_t>{0, 501})));
+        REQUIRE_FALSE(huge.includes(Multiset(Vec<id_t>{1000})));
+    }
+}
+
+TEST_CASE("Multiset algebra", "[multiset]")
+{
+    SECTION("Construction counts duplicates")
+    {
+        Multiset ms(Vec<id_t>{5, 3, 5, 1, 3, 5});
+
+        REQUIRE(ms.size() == 6);
+        REQUIRE(ms.count(1) == 1);
+        REQUIRE(ms.count(3) == 2);
+        REQUIRE(ms.count(5) == 3);
+        REQUIRE(ms.collect() == Vec<id_t>{1, 3, 3, 5, 5, 5});
+    }
+
+    SECTION("Equality ignores zero-count entries")
+    {
+        Multiset lhs(Vec<id_t>{1, 2, 3});
+        lhs.remove(2);
+
+        REQUIRE(lhs == Multiset(Vec<id_t>{1, 3}));
+        REQUIRE(Multiset(Vec<id_t>{3, 1}) == lhs);
+        REQUIRE_FALSE(lhs == Multiset(Vec<id_t>{1, 2, 3}));
+        REQUIRE_FALSE(lhs == Multiset(Vec<id_t>{1, 1}));
+    }
+
+    SECTION("Difference")
+    {
+        Multiset lhs(Vec<id_t>{1, 2, 2, 3, 7});
+        Multiset diff = lhs.msetdiff(Multiset(Vec<id_t>{2, 3, 3, 9}));
+
+        REQUIRE(diff == Multiset(Vec<id_t>{1, 2, 7}));
+        REQUIRE(diff.size() == 3);
+        REQUIRE(diff.hash() == Multiset(Vec<id_t>{1, 2, 7}).hash());
+
+        Vec<id_t> elements;
+        for (id_t i = 0; i < 1000; ++i)
+            elements.push_back(i);
+
+        REQUIRE(lhs.msetdiff(Multiset(elements)) == Multiset(Vec<id_t>{2}));
+        REQUIRE(Multiset(Vec<id_t>{5000, 3}).msetdiff(Multiset(elements)) == Multiset(Vec<id_t>{5000}));
+    }
+
+    SECTION("Insert all")
+    {
+        Multiset lhs(Vec<id_t>{1, 4, 4});
+        lhs.insert_all(Multiset(Vec<id_t>{0, 4, 5, 5}));
+
+        REQUIRE(lhs == Multiset(Vec<id_t>{0, 1, 4, 4, 4, 5, 5}));
+        REQUIRE(lhs.size() == 7);
+        REQUIRE(lhs.hash() == Multiset(Vec<id_t>{0, 1, 4, 4, 4, 5, 5}).hash());
+        REQUIRE(lhs.collect() == Vec<id_t>{0, 1, 4, 4, 4, 5, 5});
+    }
+
+    SECTION("Dedup")
+    {
+        Multiset lhs(Vec<id_t>{1, 4, 4, 5, 5, 5});
+
+        REQUIRE(lhs.dedup());
+        REQUIRE(lhs == Multiset(Vec<id_t>{1, 4, 5}));
+        REQUIRE(lhs.size() == 3);
+        REQUIRE(lhs.hash() == Multiset(Vec<id_t>{1, 4, 5}).hash());
+
+        REQUIRE_FALSE(lhs.dedup());
+    }
+
+    SECTION("Order")
+    {
+        Multiset small(Vec<id_t>{9, 9});
+        Multiset low(Vec<id_t>{1, 5, 5});
+        Multiset high(Vec<id_t>{1, 6, 7});
+
+        // size first, then the entries
+        REQUIRE(small < low);
+        REQUIRE(low < high);
+        REQUIRE_FALSE(high < low);
+        REQUIRE_FALSE(low < low);
+
+        // zero-count entries are skipped
+        Multiset removed(Vec<id_t>{0, 1, 5, 5});
+        removed.remove(0);
+        REQUIRE_FALSE(removed < low);
+        REQUIRE_FALSE(low < removed);
+        REQUIRE(removed.min() == 1);
+    }
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "utils/multiset_store.h"
+
+using namespace eqsat;
+
+TEST_CASE("MultisetStore interning", "[multiset_store]")
+{
+    MultisetStore store;
+
+    SECTION("Equal multisets share an id")
+    {
+        auto a = store.intern(Multiset(Vec<id_t>{3, 1, 2, 1}));
+        auto b = store.intern(Multiset(Vec<id_t>{1, 1, 2, 3}));
+
+        REQUIRE(a == b);
+        REQUIRE(store.size() == 1);
+        REQUIRE(store.get(a).count(1) == 2);
+    }
+
+    SECTION("Different multisets get different ids")
+    {
+        auto a = store.intern(Multiset(Vec<id_t>{1, 2}));
+        auto b = store.intern(Multiset(Vec<id_t>{1, 2, 2}));
+        auto c = store.intern(Multiset());
+
+        REQUIRE(a != b);
+        REQUIRE(a != c);
+        REQUIRE(b != c);
+        REQUIRE(store.size() == 3);
+    }
+
+    SECTION("Find does not intern")
+    {
+        REQUIRE(store.find(Multiset(Vec<id_t>{4, 5})) == MultisetStore::NONE);
+        REQUIRE(store.size() == 0);
+
+        auto id = store.intern(Multiset(Vec<id_t>{4, 5}));
+        REQUIRE(store.find(Multiset(Vec<id_t>{5, 4})) == id);
+    }
+
+    SECTION("Ids stay valid while the store grows")
+    {
+        Vec<mset_id_t> ids;
+        for (id_t i = 0; i < 1000; ++i)
+            ids.push_back(store.intern(Multiset(Vec<id_t>{i, i + 1})));
+
+        REQUIRE(store.size() == 1000);
+
+        for (id_t i = 0; i < 1000; ++i)
+        {
+            REQUIRE(store.get(ids[i]).contains(i));
+            REQUIRE(store.intern(Multiset(Vec<id_t>{i + 1, i})) == ids[i]);
+        }
+    }
+}
+
+TEST_CASE("MultisetStore sweeping", "[multiset_store]")
+{
+    MultisetStore store;
+
+    auto a = store.intern(Multiset(Vec<id_t>{1, 2}));
+    auto b = store.intern(Multiset(Vec<id_t>{2, 3}));
+    auto c = store.intern(Multiset(Vec<id_t>{3, 4}));
+
+    Vec<bool> live(store.capacity(), false);
+    live[a] = true;
+    live[c] = true;
+
+    store.sweep(live);
+
+    SECTION("Marked multisets keep their ids")
+    {
+        REQUIRE(store.size() == 2);
+        REQUIRE(store.find(Multiset(Vec<id_t>{1, 2})) == a);
+        REQUIRE(store.find(Multiset(Vec<id_t>{3, 4})) == c);
+        REQUIRE(store.get(c).contains(4));
+    }
+
+    SECTION("Swept multisets are gone and their ids are reused")
+    {
+        REQUIRE(store.find(Multiset(Vec<id_t>{2, 3})) == MultisetStore::NONE);
+
+        auto d = store.intern(Multiset(Vec<id_t>{5, 6}));
+        REQUIRE(d == b);
+        REQUIRE(store.capacity() == 3);
+        REQUIRE(store.get(d).contains(5));
+        REQUIRE(store.intern(Multiset(Vec<id_t>{2, 3})) == 3);
+    }
+}
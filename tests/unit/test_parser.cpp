@@ -35,6 +35,32 @@ TEST_CASE("Parse simple variable patterns", "[parser]")
     }
 }
 
+TEST_CASE("Parse rest variables", "[parser]")
+{
+    SymbolTable symbols;
+    Parser parser(symbols);
+
+    SECTION("Parse (mul ?x ?rest...)")
+    {
+        auto expr = parser.parse_sexpr("(mul ?x ?rest...)");
+        REQUIRE(expr->nchildren() == 2);
+
+        REQUIRE(expr->children[0]->is_variable());
+        REQUIRE_FALSE(expr->children[0]->is_rest());
+
+        REQUIRE(expr->children[1]->is_variable());
+        REQUIRE(expr->children[1]->is_rest());
+        REQUIRE(symbols.get_string(expr->children[1]->symbol) == "rest");
+
+        REQUIRE(expr->to_sexpr(symbols) == "(mul ?x ?rest...)");
+    }
+
+    SECTION("Rest variable without a name throws")
+    {
+        REQUIRE_THROWS(parser.parse_sexpr("(mul ?x ?...)"));
+    }
+}
+
 TEST_CASE("Parse nullary operators", "[parser]")
 {
     SymbolTable symbols;
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <memory>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "indices/abstract_index.h"
+#include "relations/relation_ac.h"
+#include "utils/multiset.h"
+
+using namespace eqsat;
+
+TEST_CASE("RelationAC insertion and deduplication", "[relation_ac]")
+{
+    Symbol mul = 7;
+    RelationAC rel(mul);
+
+    SECTION("Duplicate tuples are stored once")
+    {
+        rel.add_tuple({1, 2, 3, 10});
+        rel.add_tuple({3, 1, 2, 10}); // same multiset, different order
+
+        REQUIRE(rel.size() == 1);
+    }
+
+    SECTION("Same multiset in different e-classes is kept")
+    {
+        rel.add_tuple({1, 2, 10});
+        rel.add_tuple({1, 2, 11});
+
+        REQUIRE(rel.size() == 2);
+    }
+
+    SECTION("Multiplicities distinguish tuples")
+    {
+        rel.add_tuple({1, 2, 10});
+        rel.add_tuple({1, 1, 2, 10});
+        rel.add_tuple({1, 2, 2, 10});
+
+        REQUIRE(rel.size() == 3);
+    }
+
+    SECTION("Both add_tuple overloads share the index")
+    {
+        rel.add_tuple({4, 5, 10});
+        rel.add_tuple(10, Multiset(Vec<id_t>{5, 4}));
+
+        REQUIRE(rel.size() == 1);
+    }
+
+    SECTION("Lookup ignores the order of the children")
+    {
+        rel.add_tuple({1, 2, 2, 10});
+
+        REQUIRE(rel.lookup({2, 1, 2}) == 10);
+        REQUIRE_FALSE(rel.lookup({1, 2}).has_value());
+        REQUIRE_FALSE(rel.lookup({1, 2, 3}).has_value());
+    }
+}
+
+TEST_CASE("RelationAC marks the multisets of its tuples", "[relation_ac]")
+{
+    Symbol mul = 7;
+    auto store = std::make_shared<MultisetStore>();
+    RelationAC rel(mul, store);
+
+    rel.add_tuple({1, 2, 10});
+    rel.add_tuple({2, 3, 11});
+
+    // left behind, e.g. by canonicalization
+    store->intern(Multiset(Vec<id_t>{4, 5}));
+    REQUIRE(store->size() == 3);
+
+    Vec<bool> live(store->capacity(), false);
+    rel.mark_multisets(live);
+    store->sweep(live);
+
+    REQUIRE(store->size() == 2);
+    REQUIRE(store->find(Multiset(Vec<id_t>{4, 5})) == MultisetStore::NONE);
+    REQUIRE(rel.lookup({2, 1}) == 10);
+    REQUIRE(rel.lookup({3, 2}) == 11);
+}
+
+TEST_CASE("RelationAC bulk insertion", "[relation_ac]")
+{
+    Symbol mul = 7;
+    RelationAC rel(mul);
+
+    const id_t n = 20000;
+
+    for (id_t i = 0; i < n; ++i)
+        rel.add_tuple({i, i + 1, i % 100, n + i % 10});
+
+    REQUIRE(rel.size() == n);
+
+    // inserting everything again must not add anything
+    for (id_t i = 0; i < n; ++i)
+        rel.add_tuple({i % 100, i + 1, i, n + i % 10});
+
+    REQUIRE(rel.size() == n);
+}
+
+TEST_CASE("RelationAC numbers the terms of its index by size", "[relation_ac]")
+{
+    Symbol mul = 7;
+    RelationAC rel(mul);
+
+    rel.add_tuple({1, 2, 3, 4, 20});
+    rel.add_tuple({5, 6, 21});
+    rel.add_tuple({1, 1, 2, 22});
+    rel.add_tuple({2, 3, 23});
+
+    auto term_sizes = [&](size_t min_size) {
+        AbstractIndex index = rel.populate_index(0);
+        index.set_min_size(min_size);
+
+        Vec<id_t> ids;
+        index.project().for_each([&](id_t id) { ids.push_back(id); });
+        std::sort(ids.begin(), ids.end());
+
+        Vec<size_t> sizes;
+        for (id_t id : ids)
+        {
+            index.select(id);
+            sizes.push_back(index.select_rest().children.size());
+            index.unselect();
+            index.unselect();
+        }
+
+        return sizes;
+    };
+
+    REQUIRE(term_sizes(0) == Vec<size_t>{2, 2, 3, 4});
+    REQUIRE(term_sizes(3) == Vec<size_t>{3, 4});
+    REQUIRE(term_sizes(4) == Vec<size_t>{4});
+    REQUIRE(term_sizes(5).empty());
+}
+
+TEST_CASE("RelationAC index finds the terms containing a child", "[relation_ac]")
+{
+    Symbol mul = 7;
+    RelationAC rel(mul);
+
+    rel.add_tuple({1, 2, 20});
+    rel.add_tuple({2, 3, 3, 21});
+    rel.add_tuple({3, 4, 22});
+    rel.add_tuple({1, 2, 3, 5, 23});
+
+    auto containing = [&](id_t child, size_t min_size) {
+        AbstractIndex index = rel.populate_index(0);
+        index.set_min_size(min_size);
+
+        size_t n = 0;
+        index.project_containing(child).for_each([&](id_t term_id) {
+            index.select(term_id);
+
+            auto children = index.select_rest().children;
+            REQUIRE(std::find(children.begin(), children.end(), child) != children.end());
+            REQUIRE(children.size() >= min_size);
+            ++n;
+
+            index.unselect();
+            index.unselect();
+        });
+
+        return n;
+    };
+
+    REQUIRE(containing(2, 0) == 3);
+    REQUIRE(containing(3, 0) == 3);
+    REQUIRE(containing(3, 4) == 1);
+    REQUIRE(containing(4, 0) == 1);
+    REQUIRE(containing(9, 0) == 0);
+}
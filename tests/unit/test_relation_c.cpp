@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "relations/relation_c.h"
+#include "utils/permutation.h"
+
+using namespace eqsat;
+
+TEST_CASE("RelationC stores each argument pair once", "[relation_c]")
+{
+    Symbol nand = 3;
+    RelationC rel(nand);
+
+    rel.add_tuple({2, 1, 10});
+
+    SECTION("The index yields both argument orders")
+    {
+        auto index = rel.populate_index(0); // (arg1, arg2, id)
+
+        REQUIRE(index.project().size() == 2);
+
+        index.select(2);
+        REQUIRE(index.project().size() == 1);
+        REQUIRE(index.project().contains(1));
+        index.select(1);
+        REQUIRE(index.project().contains(10));
+    }
+
+    SECTION("The e-class column can come first")
+    {
+        uint32_t perm = permutation_to_index({2, 0, 1}); // (id, arg1, arg2)
+        auto index = rel.populate_index(perm);
+
+        REQUIRE(index.project().size() == 1);
+
+        index.select(10);
+        REQUIRE(index.project().size() == 2);
+        index.select(2);
+        REQUIRE(index.project().contains(1));
+    }
+
+    SECTION("Both orders of the argument columns share one index")
+    {
+        auto swapped = [](uint32_t perm) {
+            auto columns = index_to_permutation(perm, {0, 1, 2});
+            for (auto& column : columns)
+                if (column < 2)
+                    column = 1 - column;
+            return permutation_to_index(columns);
+        };
+
+        for (uint32_t perm = 0; perm < 6; ++perm)
+            REQUIRE(rel.normalize_permutation(perm) == rel.normalize_permutation(swapped(perm)));
+
+        REQUIRE(rel.normalize_permutation(permutation_to_index({1, 0, 2})) == 0);
+        REQUIRE(rel.normalize_permutation(permutation_to_index({2, 1, 0})) == permutation_to_index({2, 0, 1}));
+    }
+
+    SECTION("Lookup accepts both argument orders")
+    {
+        REQUIRE(rel.lookup({1, 2}) == 10);
+        REQUIRE(rel.lookup({2, 1}) == 10);
+        REQUIRE_FALSE(rel.lookup({2, 2}).has_value());
+    }
+}
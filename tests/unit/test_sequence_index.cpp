@@ -0,0 +1,97 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "indices/sequence_index.h"
+
+using namespace eqsat;
+
+TEST_CASE("SequenceIndex matches contiguous windows", "[sequence_index]")
+{
+    Symbol comp = 42;
+
+    // term 0: [10, 20, 10, 30]
+    // term 1: [20, 30]
+    auto sequences = std::make_shared<Vec<Sequence>>();
+    sequences->push_back(std::make_shared<const Vec<id_t>>(Vec<id_t>{10, 20, 10, 30}));
+    sequences->push_back(std::make_shared<const Vec<id_t>>(Vec<id_t>{20, 30}));
+
+    SequenceIndex index(comp, sequences);
+
+    SECTION("Term-ids come first")
+    {
+        AbstractSet terms = index.project();
+        REQUIRE(terms.size() == 2);
+        REQUIRE(terms.contains(0));
+        REQUIRE(terms.contains(1));
+    }
+
+    SECTION("Every element can start a window")
+    {
+        index.select(0);
+
+        AbstractSet first = index.project();
+        REQUIRE(first.size() == 3);
+        REQUIRE(first.contains(10));
+        REQUIRE(first.contains(20));
+        REQUIRE(first.contains(30));
+    }
+
+    SECTION("Further children follow all matching windows")
+    {
+        index.select(0);
+        index.select(10);
+
+        // 10 occurs twice, followed by 20 and by 30
+        AbstractSet second = index.project();
+        REQUIRE(second.size() == 2);
+        REQUIRE(second.contains(20));
+        REQUIRE(second.contains(30));
+
+        index.select(30);
+        REQUIRE(index.project().size() == 0);
+
+        ENode enode = index.make_enode();
+        REQUIRE(enode.op == comp);
+        REQUIRE(enode.children == Vec<id_t>{10, 30});
+    }
+
+    SECTION("The order of the children matters")
+    {
+        index.select(1);
+        index.select(30);
+
+        REQUIRE(index.project().size() == 0);
+    }
+
+    SECTION("Unselect restores the previous windows")
+    {
+        index.select(0);
+        index.select(10);
+        index.select(20);
+        index.unselect();
+
+        REQUIRE(index.project().size() == 2);
+
+        index.unselect();
+        index.unselect();
+
+        REQUIRE(index.project().size() == 2); // term-ids again
+    }
+}
+
+TEST_CASE("SequenceIndex skips positions without a sequence", "[sequence_index]")
+{
+    Symbol comp = 42;
+
+    auto sequences = std::make_shared<Vec<Sequence>>();
+    sequences->push_back(std::make_shared<const Vec<id_t>>(Vec<id_t>{10, 20}));
+    sequences->push_back(nullptr);
+    sequences->push_back(std::make_shared<const Vec<id_t>>(Vec<id_t>{20, 30}));
+
+    SequenceIndex index(comp, sequences);
+
+    AbstractSet terms = index.project();
+    REQUIRE(terms.size() == 2);
+    REQUIRE(terms.contains(0));
+    REQUIRE_FALSE(terms.contains(1));
+    REQUIRE(terms.contains(2));
+}
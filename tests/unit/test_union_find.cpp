@@ -164,3 +164,104 @@ TEST_CASE("UnionFind path compression", "[union_find]")
         }
     }
 }
+
+TEST_CASE("UnionFind union log", "[union_find]")
+{
+    UnionFind uf;
+
+    SECTION("log starts empty")
+    {
+        uf.make_set();
+        uf.make_set();
+
+        REQUIRE(uf.union_log().empty());
+    }
+
+    SECTION("log records re-rooted ids in order")
+    {
+        id_t id1 = uf.make_set();
+        id_t id2 = uf.make_set();
+        id_t id3 = uf.make_set();
+
+        uf.unify(id2, id3);
+        uf.unify(id1, id2);
+
+        REQUIRE(uf.union_log().size() == 2);
+        REQUIRE(uf.union_log()[0] == id3);
+        REQUIRE(uf.union_log()[1] == id2);
+    }
+
+    SECTION("redundant unifications are not logged")
+    {
+        id_t id1 = uf.make_set();
+        id_t id2 = uf.make_set();
+
+        uf.unify(id1, id2);
+        uf.unify(id2, id1);
+
+        REQUIRE(uf.union_log().size() == 1);
+    }
+}
+
+TEST_CASE("UnionFind union policies", "[union_find]")
+{
+    SECTION("lowest-id keeps the smaller id canonical")
+    {
+        UnionFind uf;
+
+        id_t id1 = uf.make_set();
+        id_t id2 = uf.make_set();
+        id_t id3 = uf.make_set();
+
+        uf.unify(id2, id3);
+        REQUIRE(uf.unify(id3, id1) == id1);
+        REQUIRE(uf.find_root(id3) == id1);
+    }
+
+    SECTION("by-size keeps the root of the larger class")
+    {
+        UnionFind uf(UnionPolicy::BySize);
+
+        id_t id1 = uf.make_set();
+        id_t id2 = uf.make_set();
+        id_t id3 = uf.make_set();
+
+        // ties keep the smaller id
+        REQUIRE(uf.unify(id3, id2) == id2);
+        REQUIRE(uf.unify(id1, id3) == id2);
+
+        REQUIRE(uf.find_root(id1) == id2);
+        REQUIRE(uf.union_log().back() == id1);
+        REQUIRE(uf.eclasses() == 1);
+    }
+}
+
+TEST_CASE("UnionFind normalize points every id at its root", "[union_find]")
+{
+    for (auto policy : {UnionPolicy::LowestId, UnionPolicy::BySize})
+    {
+        UnionFind uf(policy);
+
+        const int n = 64;
+        for (int i = 0; i < n; ++i)
+            uf.make_set();
+
+        // a long chain under lowest-id roots
+        for (int i = n - 1; i > 0; --i)
+            uf.unify(static_cast<id_t>(i - 1), static_cast<id_t>(i));
+
+        id_t root = uf.find_root(0);
+
+        // lowest-id roots leave the last id at the end of the chain
+        if (policy == UnionPolicy::LowestId)
+            REQUIRE(uf.parent(static_cast<id_t>(n - 1)) != root);
+
+        uf.normalize();
+
+        for (int i = 0; i < n; ++i)
+        {
+            REQUIRE(uf.parent(static_cast<id_t>(i)) == root);
+            REQUIRE(uf.find_root(static_cast<id_t>(i)) == root);
+        }
+    }
+}